@@ -428,6 +428,23 @@ static int elf_read(struct file *file, void *buf, size_t len, loff_t pos)
 	return 0;
 }
 
+/* Read the ELF header of a file being executed, cached if possible */
+static int elf_read_ehdr(struct file *file, struct elfhdr *elf_ex)
+{
+	struct elf_layout *layout = elf_layout_get(file);
+
+	if (layout) {
+		bool hit = layout->ehdr_size == sizeof(*elf_ex);
+
+		if (hit)
+			memcpy(elf_ex, layout->data, sizeof(*elf_ex));
+		elf_layout_put(layout);
+		if (hit)
+			return 0;
+	}
+	return elf_read(file, elf_ex, sizeof(*elf_ex), 0);
+}
+
 static unsigned long maximum_alignment(struct elf_phdr *cmds, int nr)
 {
 	unsigned long alignment = 0;
@@ -456,11 +473,15 @@ static unsigned long maximum_alignment(struct elf_phdr *cmds, int nr)
  * Loads ELF program headers from the binary file elf_file, which has the ELF
  * header pointed to by elf_ex, into a newly allocated array. The caller is
  * responsible for freeing the allocated data. Returns an ERR_PTR upon failure.
+ *
+ * The headers come from the layout cache of elf_file when it has them for
+ * the same ELF header, and are added to it otherwise.
  */
 static struct elf_phdr *load_elf_phdrs(const struct elfhdr *elf_ex,
 				       struct file *elf_file)
 {
 	struct elf_phdr *elf_phdata = NULL;
+	struct elf_layout *layout;
 	int retval, err = -1;
 	unsigned int size;
 
@@ -477,6 +498,18 @@ static struct elf_phdr *load_elf_phdrs(const struct elfhdr *elf_ex,
 	if (size == 0 || size > 65536 || size > ELF_MIN_ALIGN)
 		goto out;
 
+	layout = elf_layout_get(elf_file);
+	if (layout) {
+		if (layout->ehdr_size == sizeof(*elf_ex) &&
+		    layout->phdr_size == size &&
+		    !memcmp(layout->data, elf_ex, sizeof(*elf_ex)))
+			elf_phdata = kmemdup(layout->data + sizeof(*elf_ex),
+					     size, GFP_KERNEL);
+		elf_layout_put(layout);
+		if (elf_phdata)
+			return elf_phdata;
+	}
+
 	elf_phdata = kmalloc(size, GFP_KERNEL);
 	if (!elf_phdata)
 		goto out;
@@ -488,6 +521,8 @@ static struct elf_phdr *load_elf_phdrs(const struct elfhdr *elf_ex,
 		goto out;
 	}
 
+	elf_layout_add(elf_file, elf_ex, sizeof(*elf_ex), elf_phdata, size);
+
 	/* Success! */
 	err = 0;
 out:
@@ -914,8 +949,7 @@ static int load_elf_binary(struct linux_binprm *bprm)
 		}
 
 		/* Get the exec headers */
-		retval = elf_read(interpreter, interp_elf_ex,
-				  sizeof(*interp_elf_ex), 0);
+		retval = elf_read_ehdr(interpreter, interp_elf_ex);
 		if (retval < 0)
 			goto out_free_dentry;
 
@@ -0,0 +1,123 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Cache of the ELF header and program headers of executed files.
+ *
+ * Build machines execute the same compiler, shell and dynamic linker
+ * millions of times, and every exec reads and checks their headers again.
+ * The headers are kept with the inode instead, for both the ELF loaders
+ * (native and compat), which check and use them the same way as headers
+ * read from the file.
+ *
+ * An entry is only created or used while the file is denied write access,
+ * as it is for the whole of an exec.  Whoever gets write access to the
+ * inode afterwards drops the entry, see get_write_access(), so a writer
+ * can never race with an exec using it.  Size and times are checked as
+ * well, for filesystems whose files can change under us without a local
+ * writer.
+ */
+
+#include <linux/binfmts.h>
+#include <linux/fs.h>
+#include <linux/overflow.h>
+#include <linux/rcupdate.h>
+#include <linux/refcount.h>
+#include <linux/slab.h>
+
+/* Binaries with more headers than this are just read every time */
+#define ELF_LAYOUT_MAX_SIZE	2048
+
+static bool elf_layout_current(const struct elf_layout *layout,
+			       struct inode *inode)
+{
+	return layout->size == i_size_read(inode) &&
+	       timespec64_equal(&layout->mtime, &inode->i_mtime) &&
+	       timespec64_equal(&layout->ctime, &inode->i_ctime);
+}
+
+void elf_layout_put(struct elf_layout *layout)
+{
+	if (refcount_dec_and_test(&layout->refs))
+		kfree_rcu(layout, rcu);
+}
+
+void __elf_layout_invalidate(struct inode *inode)
+{
+	struct elf_layout *layout = xchg(&inode->i_elf_layout, NULL);
+
+	if (layout)
+		elf_layout_put(layout);
+}
+EXPORT_SYMBOL(__elf_layout_invalidate);
+
+/**
+ * elf_layout_get() - look up the cached headers of a file being executed
+ * @file: the file, which must be denied write access
+ *
+ * Return: a reference to the cached headers, to be dropped with
+ * elf_layout_put(), or NULL.  The caller checks that they are of the
+ * expected ELF class.
+ */
+struct elf_layout *elf_layout_get(struct file *file)
+{
+	struct inode *inode = file_inode(file);
+	struct elf_layout *layout;
+
+	if (atomic_read(&inode->i_writecount) >= 0)
+		return NULL;
+
+	rcu_read_lock();
+	layout = READ_ONCE(inode->i_elf_layout);
+	if (layout && !refcount_inc_not_zero(&layout->refs))
+		layout = NULL;
+	rcu_read_unlock();
+
+	if (layout && !elf_layout_current(layout, inode)) {
+		/* Changed behind our back, only drop it if still cached */
+		if (cmpxchg(&inode->i_elf_layout, layout, NULL) == layout)
+			elf_layout_put(layout);
+		elf_layout_put(layout);
+		layout = NULL;
+	}
+	return layout;
+}
+
+/**
+ * elf_layout_add() - cache the headers just read from a file being executed
+ * @file:      the file, which must be denied write access
+ * @ehdr:      its ELF header
+ * @ehdr_size: size of @ehdr, which depends on the ELF class
+ * @phdrs:     its program headers
+ * @phdr_size: total size of @phdrs
+ *
+ * Does nothing if the file already has cached headers.
+ */
+void elf_layout_add(struct file *file, const void *ehdr,
+		    unsigned int ehdr_size, const void *phdrs,
+		    unsigned int phdr_size)
+{
+	struct inode *inode = file_inode(file);
+	struct elf_layout *layout;
+
+	if (!S_ISREG(inode->i_mode) ||
+	    atomic_read(&inode->i_writecount) >= 0 ||
+	    ehdr_size + phdr_size > ELF_LAYOUT_MAX_SIZE ||
+	    READ_ONCE(inode->i_elf_layout))
+		return;
+
+	layout = kmalloc(struct_size(layout, data, ehdr_size + phdr_size),
+			 GFP_KERNEL);
+	if (!layout)
+		return;
+
+	refcount_set(&layout->refs, 1);
+	layout->size = i_size_read(inode);
+	layout->mtime = inode->i_mtime;
+	layout->ctime = inode->i_ctime;
+	layout->ehdr_size = ehdr_size;
+	layout->phdr_size = phdr_size;
+	memcpy(layout->data, ehdr, ehdr_size);
+	memcpy(layout->data + ehdr_size, phdrs, phdr_size);
+
+	if (cmpxchg(&inode->i_elf_layout, NULL, layout))
+		kfree(layout);
+}
@@ -685,6 +685,11 @@ struct btrfs_fs_info {
 	struct super_block *sb;
 	struct inode *btree_inode;
 	struct mutex tree_log_mutex;
+	/*
+	 * Running average of how long a log commit takes, in ns. Used to size
+	 * the fsync batching window. Protected by tree_log_mutex.
+	 */
+	u64 avg_log_commit_time;
 	struct mutex transaction_kthread_mutex;
 	struct mutex cleaner_mutex;
 	struct mutex chunk_mutex;
@@ -1109,6 +1114,8 @@ struct btrfs_root {
 	/* Just be updated when the commit succeeds. */
 	int last_log_commit;
 	pid_t log_start_pid;
+	/* When the current log transaction got its first writer, in ns */
+	u64 log_start_time;
 
 	u64 last_trans;
 
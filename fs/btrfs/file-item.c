@@ -258,6 +258,7 @@ static int search_csum_tree(struct btrfs_fs_info *fs_info,
 			    u64 len, u8 *dst)
 {
 	struct btrfs_csum_item *item = NULL;
+	struct extent_buffer *leaf;
 	struct btrfs_key key;
 	const u32 sectorsize = fs_info->sectorsize;
 	const u32 csum_size = fs_info->csum_size;
@@ -270,17 +271,45 @@ static int search_csum_tree(struct btrfs_fs_info *fs_info,
 	       IS_ALIGNED(len, sectorsize));
 
 	/* Check if the current csum item covers disk_bytenr */
-	if (path->nodes[0]) {
-		item = btrfs_item_ptr(path->nodes[0], path->slots[0],
-				      struct btrfs_csum_item);
-		btrfs_item_key_to_cpu(path->nodes[0], &key, path->slots[0]);
-		itemsize = btrfs_item_size_nr(path->nodes[0], path->slots[0]);
+	leaf = path->nodes[0];
+	if (leaf && path->slots[0] < btrfs_header_nritems(leaf)) {
+		btrfs_item_key_to_cpu(leaf, &key, path->slots[0]);
+		itemsize = btrfs_item_size_nr(leaf, path->slots[0]);
 
 		csum_start = key.offset;
 		csum_len = (itemsize / csum_size) * sectorsize;
 
-		if (in_range(disk_bytenr, csum_start, csum_len))
+		if (key.type == BTRFS_EXTENT_CSUM_KEY &&
+		    in_range(disk_bytenr, csum_start, csum_len))
 			goto found;
+
+		/*
+		 * Reads walk the csum tree forward, so the item we want next
+		 * is usually the following one in the same leaf.  Look there
+		 * before searching again from the root.  Csum items never
+		 * overlap, so if disk_bytenr falls between the two items it
+		 * has no csum and we can say so right away.
+		 */
+		if (key.type == BTRFS_EXTENT_CSUM_KEY &&
+		    disk_bytenr >= csum_start + csum_len &&
+		    path->slots[0] + 1 < btrfs_header_nritems(leaf)) {
+			btrfs_item_key_to_cpu(leaf, &key, path->slots[0] + 1);
+			if (key.objectid == BTRFS_EXTENT_CSUM_OBJECTID &&
+			    key.type == BTRFS_EXTENT_CSUM_KEY) {
+				if (disk_bytenr < key.offset)
+					return 0;
+
+				itemsize = btrfs_item_size_nr(leaf,
+							path->slots[0] + 1);
+				csum_start = key.offset;
+				csum_len = (itemsize / csum_size) * sectorsize;
+				if (in_range(disk_bytenr, csum_start,
+					     csum_len)) {
+					path->slots[0]++;
+					goto found;
+				}
+			}
+		}
 	}
 
 	/* Current item doesn't contain the desired range, search again */
@@ -290,18 +319,23 @@ static int search_csum_tree(struct btrfs_fs_info *fs_info,
 		ret = PTR_ERR(item);
 		goto out;
 	}
-	btrfs_item_key_to_cpu(path->nodes[0], &key, path->slots[0]);
-	itemsize = btrfs_item_size_nr(path->nodes[0], path->slots[0]);
+	leaf = path->nodes[0];
+	btrfs_item_key_to_cpu(leaf, &key, path->slots[0]);
+	itemsize = btrfs_item_size_nr(leaf, path->slots[0]);
 
 	csum_start = key.offset;
 	csum_len = (itemsize / csum_size) * sectorsize;
 	ASSERT(in_range(disk_bytenr, csum_start, csum_len));
 
 found:
+	/* Copy every csum this item has for the rest of the range at once. */
+	item = btrfs_item_ptr(leaf, path->slots[0], struct btrfs_csum_item);
 	ret = (min(csum_start + csum_len, disk_bytenr + len) -
 		   disk_bytenr) >> fs_info->sectorsize_bits;
-	read_extent_buffer(path->nodes[0], dst, (unsigned long)item,
-			ret * csum_size);
+	read_extent_buffer(leaf, dst, (unsigned long)item +
+			   ((disk_bytenr - csum_start) >>
+			    fs_info->sectorsize_bits) * csum_size,
+			   ret * csum_size);
 out:
 	if (ret == -ENOENT)
 		ret = 0;
@@ -3093,30 +3093,35 @@ void btrfs_writepage_endio_finish_ordered(struct page *page, u64 start,
 }
 
 /*
- * check_data_csum - verify checksum of one sector of uncompressed data
+ * check_data_csum - verify checksums of uncompressed data in one page
  * @inode:	inode
  * @io_bio:	btrfs_io_bio which contains the csum
  * @bio_offset:	offset to the beginning of the bio (in bytes)
  * @page:	page where is the data to be verified
  * @pgoff:	offset inside the page
  * @start:	logical offset in the file
+ * @len:	length to verify, a multiple of the sector size
  *
- * The length of such check is always one sector size.
+ * Each sector is checked against its own csum, but the page is mapped and the
+ * hash descriptor set up only once for the whole range. Verification stops at
+ * the first bad sector.
  */
 static int check_data_csum(struct inode *inode, struct btrfs_io_bio *io_bio,
 			   u32 bio_offset, struct page *page, u32 pgoff,
-			   u64 start)
+			   u64 start, u32 len)
 {
 	struct btrfs_fs_info *fs_info = btrfs_sb(inode->i_sb);
 	SHASH_DESC_ON_STACK(shash, fs_info->csum_shash);
 	char *kaddr;
-	u32 len = fs_info->sectorsize;
+	const u32 sectorsize = fs_info->sectorsize;
 	const u32 csum_size = fs_info->csum_size;
 	unsigned int offset_sectors;
 	u8 *csum_expected;
 	u8 csum[BTRFS_CSUM_SIZE];
+	u32 cur;
 
 	ASSERT(pgoff + len <= PAGE_SIZE);
+	ASSERT(IS_ALIGNED(len, sectorsize));
 
 	offset_sectors = bio_offset >> fs_info->sectorsize_bits;
 	csum_expected = ((u8 *)io_bio->csum) + offset_sectors * csum_size;
@@ -3124,20 +3129,23 @@ static int check_data_csum(struct inode *inode, struct btrfs_io_bio *io_bio,
 	kaddr = kmap_atomic(page);
 	shash->tfm = fs_info->csum_shash;
 
-	crypto_shash_digest(shash, kaddr + pgoff, len, csum);
-
-	if (memcmp(csum, csum_expected, csum_size))
-		goto zeroit;
+	for (cur = 0; cur < len; cur += sectorsize) {
+		crypto_shash_digest(shash, kaddr + pgoff + cur, sectorsize,
+				    csum);
+		if (memcmp(csum, csum_expected, csum_size))
+			goto zeroit;
+		csum_expected += csum_size;
+	}
 
 	kunmap_atomic(kaddr);
 	return 0;
 zeroit:
-	btrfs_print_data_csum_error(BTRFS_I(inode), start, csum, csum_expected,
-				    io_bio->mirror_num);
+	btrfs_print_data_csum_error(BTRFS_I(inode), start + cur, csum,
+				    csum_expected, io_bio->mirror_num);
 	if (io_bio->device)
 		btrfs_dev_stat_inc_and_print(io_bio->device,
 					     BTRFS_DEV_STAT_CORRUPTION_ERRS);
-	memset(kaddr + pgoff, 1, len);
+	memset(kaddr + pgoff + cur, 1, sectorsize);
 	flush_dcache_page(page);
 	kunmap_atomic(kaddr);
 	return -EIO;
@@ -3159,8 +3167,6 @@ int btrfs_verify_data_csum(struct btrfs_io_bio *io_bio, u32 bio_offset,
 	struct inode *inode = page->mapping->host;
 	struct extent_io_tree *io_tree = &BTRFS_I(inode)->io_tree;
 	struct btrfs_root *root = BTRFS_I(inode)->root;
-	const u32 sectorsize = root->fs_info->sectorsize;
-	u32 pg_off;
 
 	if (PageChecked(page)) {
 		ClearPageChecked(page);
@@ -3181,17 +3187,8 @@ int btrfs_verify_data_csum(struct btrfs_io_bio *io_bio, u32 bio_offset,
 
 	ASSERT(page_offset(page) <= start &&
 	       end <= page_offset(page) + PAGE_SIZE - 1);
-	for (pg_off = offset_in_page(start);
-	     pg_off < offset_in_page(end);
-	     pg_off += sectorsize, bio_offset += sectorsize) {
-		int ret;
-
-		ret = check_data_csum(inode, io_bio, bio_offset, page, pg_off,
-				      page_offset(page) + pg_off);
-		if (ret < 0)
-			return -EIO;
-	}
-	return 0;
+	return check_data_csum(inode, io_bio, bio_offset, page,
+			       offset_in_page(start), start, end + 1 - start);
 }
 
 /*
@@ -7914,7 +7911,8 @@ static blk_status_t btrfs_check_read_dio_bio(struct inode *inode,
 			if (uptodate &&
 			    (!csum || !check_data_csum(inode, io_bio,
 						       bio_offset, bvec.bv_page,
-						       pgoff, start))) {
+						       pgoff, start,
+						       sectorsize))) {
 				clean_io_failure(fs_info, failure_tree, io_tree,
 						 start, bvec.bv_page,
 						 btrfs_ino(BTRFS_I(inode)),
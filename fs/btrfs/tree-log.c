@@ -8,6 +8,7 @@
 #include <linux/blkdev.h>
 #include <linux/list_sort.h>
 #include <linux/iversion.h>
+#include <linux/hrtimer.h>
 #include "misc.h"
 #include "ctree.h"
 #include "tree-log.h"
@@ -182,6 +183,7 @@ static int start_log_trans(struct btrfs_trans_handle *trans,
 		if (!root->log_start_pid) {
 			clear_bit(BTRFS_ROOT_MULTI_LOG_TASKS, &root->state);
 			root->log_start_pid = current->pid;
+			root->log_start_time = ktime_get_ns();
 		} else if (root->log_start_pid != current->pid) {
 			set_bit(BTRFS_ROOT_MULTI_LOG_TASKS, &root->state);
 		}
@@ -204,6 +206,7 @@ static int start_log_trans(struct btrfs_trans_handle *trans,
 		set_bit(BTRFS_ROOT_HAS_LOG_TREE, &root->state);
 		clear_bit(BTRFS_ROOT_MULTI_LOG_TASKS, &root->state);
 		root->log_start_pid = current->pid;
+		root->log_start_time = ktime_get_ns();
 	}
 
 	atomic_inc(&root->log_writers);
@@ -3040,6 +3043,45 @@ static inline void btrfs_remove_all_log_ctxs(struct btrfs_root *root,
 	INIT_LIST_HEAD(&root->log_ctxs[index]);
 }
 
+/*
+ * Upper bound for how long btrfs_sync_log() keeps a log transaction with
+ * several writers open to let more fsyncs join it, in microseconds.
+ */
+#define BTRFS_LOG_MAX_BATCH_TIME	15000
+
+/*
+ * Give other tasks logging into the same root a chance to join this log
+ * commit, so that concurrent fsyncs share one round of tree block writes
+ * and one superblock write instead of each paying for their own.
+ *
+ * Like jbd2, wait about as long as a log commit takes, but only while the
+ * log transaction is younger than that. A lone fsync never waits, a log
+ * transaction that has already been open for long enough is committed at
+ * once, and fast devices (short commits) only wait very briefly.
+ *
+ * Called and returns with root->log_mutex held.
+ */
+static void btrfs_log_batch_wait(struct btrfs_root *root)
+{
+	struct btrfs_fs_info *fs_info = root->fs_info;
+	u64 commit_time;
+	ktime_t expires;
+
+	if (!test_bit(BTRFS_ROOT_MULTI_LOG_TASKS, &root->state))
+		return;
+
+	commit_time = min_t(u64, READ_ONCE(fs_info->avg_log_commit_time),
+			    BTRFS_LOG_MAX_BATCH_TIME * NSEC_PER_USEC);
+	if (ktime_get_ns() - root->log_start_time >= commit_time)
+		return;
+
+	expires = ns_to_ktime(root->log_start_time + commit_time);
+	mutex_unlock(&root->log_mutex);
+	set_current_state(TASK_UNINTERRUPTIBLE);
+	schedule_hrtimeout(&expires, HRTIMER_MODE_ABS);
+	mutex_lock(&root->log_mutex);
+}
+
 /*
  * btrfs_sync_log does sends a given tree log down to the disk and
  * updates the super blocks to record it.  When this call is done,
@@ -3068,6 +3110,7 @@ int btrfs_sync_log(struct btrfs_trans_handle *trans,
 	struct blk_plug plug;
 	u64 log_root_start;
 	u64 log_root_level;
+	u64 commit_start;
 
 	mutex_lock(&root->log_mutex);
 	log_transid = ctx->log_transid;
@@ -3091,17 +3134,13 @@ int btrfs_sync_log(struct btrfs_trans_handle *trans,
 
 	while (1) {
 		int batch = atomic_read(&root->log_batch);
-		/* when we're on an ssd, just kick the log commit out */
-		if (!btrfs_test_opt(fs_info, SSD) &&
-		    test_bit(BTRFS_ROOT_MULTI_LOG_TASKS, &root->state)) {
-			mutex_unlock(&root->log_mutex);
-			schedule_timeout_uninterruptible(1);
-			mutex_lock(&root->log_mutex);
-		}
+
+		btrfs_log_batch_wait(root);
 		wait_for_writer(root);
 		if (batch == atomic_read(&root->log_batch))
 			break;
 	}
+	commit_start = ktime_get_ns();
 
 	/* bail out if we need to do a full commit */
 	if (btrfs_need_log_full_commit(trans)) {
@@ -3300,6 +3339,16 @@ int btrfs_sync_log(struct btrfs_trans_handle *trans,
 	btrfs_set_super_log_root(fs_info->super_for_commit, log_root_start);
 	btrfs_set_super_log_root_level(fs_info->super_for_commit, log_root_level);
 	ret = write_all_supers(fs_info, 1);
+	if (!ret) {
+		u64 commit_time = ktime_get_ns() - commit_start;
+
+		if (fs_info->avg_log_commit_time)
+			fs_info->avg_log_commit_time =
+				(commit_time +
+				 fs_info->avg_log_commit_time * 3) / 4;
+		else
+			fs_info->avg_log_commit_time = commit_time;
+	}
 	mutex_unlock(&fs_info->tree_log_mutex);
 	if (ret) {
 		btrfs_set_log_full_commit(trans);
@@ -175,6 +175,30 @@ int proc_nr_dentry(struct ctl_table *table, int write, void *buffer,
 }
 #endif
 
+/*
+ * Maximum number of unused negative dentries per superblock, 0 means no
+ * limit.  Beyond it the oldest ones are trimmed by prune_negative_dentries().
+ */
+unsigned long sysctl_negative_dentry_limit __read_mostly;
+
+static inline void d_negative_inc(struct dentry *dentry)
+{
+	struct super_block *sb = dentry->d_sb;
+	unsigned long limit = READ_ONCE(sysctl_negative_dentry_limit);
+
+	this_cpu_inc(nr_dentry_negative);
+	percpu_counter_inc(&sb->s_nr_dentry_negative);
+	if (unlikely(limit) &&
+	    percpu_counter_read_positive(&sb->s_nr_dentry_negative) > limit)
+		queue_work(system_unbound_wq, &sb->s_negative_dentry_work);
+}
+
+static inline void d_negative_dec(struct dentry *dentry)
+{
+	this_cpu_dec(nr_dentry_negative);
+	percpu_counter_dec(&dentry->d_sb->s_nr_dentry_negative);
+}
+
 /*
  * Compare 2 name strings, return 0 if they match, otherwise non-zero.
  * The strings are both count bytes long, and count is non-zero.
@@ -330,7 +354,7 @@ static inline void __d_clear_type_and_inode(struct dentry *dentry)
 	WRITE_ONCE(dentry->d_flags, flags);
 	dentry->d_inode = NULL;
 	if (dentry->d_flags & DCACHE_LRU_LIST)
-		this_cpu_inc(nr_dentry_negative);
+		d_negative_inc(dentry);
 }
 
 static void dentry_free(struct dentry *dentry)
@@ -400,7 +424,7 @@ static void d_lru_add(struct dentry *dentry)
 	dentry->d_flags |= DCACHE_LRU_LIST;
 	this_cpu_inc(nr_dentry_unused);
 	if (d_is_negative(dentry))
-		this_cpu_inc(nr_dentry_negative);
+		d_negative_inc(dentry);
 	WARN_ON_ONCE(!list_lru_add(&dentry->d_sb->s_dentry_lru, &dentry->d_lru));
 }
 
@@ -410,7 +434,7 @@ static void d_lru_del(struct dentry *dentry)
 	dentry->d_flags &= ~DCACHE_LRU_LIST;
 	this_cpu_dec(nr_dentry_unused);
 	if (d_is_negative(dentry))
-		this_cpu_dec(nr_dentry_negative);
+		d_negative_dec(dentry);
 	WARN_ON_ONCE(!list_lru_del(&dentry->d_sb->s_dentry_lru, &dentry->d_lru));
 }
 
@@ -442,7 +466,7 @@ static void d_lru_isolate(struct list_lru_one *lru, struct dentry *dentry)
 	dentry->d_flags &= ~DCACHE_LRU_LIST;
 	this_cpu_dec(nr_dentry_unused);
 	if (d_is_negative(dentry))
-		this_cpu_dec(nr_dentry_negative);
+		d_negative_dec(dentry);
 	list_lru_isolate(lru, &dentry->d_lru);
 }
 
@@ -452,7 +476,7 @@ static void d_lru_shrink_move(struct list_lru_one *lru, struct dentry *dentry,
 	D_FLAG_VERIFY(dentry, DCACHE_LRU_LIST);
 	dentry->d_flags |= DCACHE_SHRINK_LIST;
 	if (d_is_negative(dentry))
-		this_cpu_dec(nr_dentry_negative);
+		d_negative_dec(dentry);
 	list_lru_isolate_move(lru, &dentry->d_lru, list);
 }
 
@@ -1277,6 +1301,101 @@ static enum lru_status dentry_lru_isolate_shrink(struct list_head *item,
 }
 
 
+struct negative_dentry_walk {
+	struct list_head	dispose;
+	unsigned long		skip;	/* skipped entries at the LRU head */
+	unsigned long		seen;	/* entries seen in this batch */
+};
+
+static enum lru_status dentry_lru_isolate_negative(struct list_head *item,
+		struct list_lru_one *lru, spinlock_t *lru_lock, void *arg)
+{
+	struct negative_dentry_walk *walk = arg;
+	struct list_head *freeable = &walk->dispose;
+	struct dentry	*dentry = container_of(item, struct dentry, d_lru);
+
+	/*
+	 * Every walk starts at the head of the LRU, where the entries skipped
+	 * by earlier batches still are.  Step over them without looking.
+	 */
+	if (walk->seen++ < walk->skip)
+		return LRU_SKIP;
+
+	/*
+	 * Positive dentries are left where they are, so that we don't upset
+	 * the aging the shrinker relies on.
+	 */
+	if (!d_is_negative(dentry))
+		goto skip;
+
+	if (!spin_trylock(&dentry->d_lock))
+		goto skip;
+
+	if (!d_is_negative(dentry)) {
+		spin_unlock(&dentry->d_lock);
+		goto skip;
+	}
+
+	if (dentry->d_lockref.count) {
+		d_lru_isolate(lru, dentry);
+		spin_unlock(&dentry->d_lock);
+		return LRU_REMOVED;
+	}
+
+	/* Negative dentries that get hit are worth keeping */
+	if (dentry->d_flags & DCACHE_REFERENCED) {
+		dentry->d_flags &= ~DCACHE_REFERENCED;
+		spin_unlock(&dentry->d_lock);
+		return LRU_ROTATE;
+	}
+
+	d_lru_shrink_move(lru, dentry, freeable);
+	spin_unlock(&dentry->d_lock);
+
+	return LRU_REMOVED;
+
+skip:
+	walk->skip++;
+	return LRU_SKIP;
+}
+
+/**
+ * prune_negative_dentries - trim negative dentries of a superblock
+ * @work: the superblock's s_negative_dentry_work
+ *
+ * Queued when the number of unused negative dentries of a superblock goes
+ * over sysctl_negative_dentry_limit.  Walks the LRU at most once, freeing
+ * the oldest negative dentries until the count is back below 7/8 of the
+ * limit, so that we don't get requeued right away.
+ */
+void prune_negative_dentries(struct work_struct *work)
+{
+	struct super_block *sb = container_of(work, struct super_block,
+					      s_negative_dentry_work);
+	unsigned long limit = READ_ONCE(sysctl_negative_dentry_limit);
+	struct negative_dentry_walk walk = { .skip = 0 };
+	unsigned long nr_to_walk;
+
+	if (!limit || !trylock_super(sb))
+		return;
+
+	nr_to_walk = list_lru_count(&sb->s_dentry_lru);
+	while (nr_to_walk &&
+	       percpu_counter_read_positive(&sb->s_nr_dentry_negative) >
+	       limit - limit / 8) {
+		unsigned long nr = min(nr_to_walk, 1024UL);
+
+		nr_to_walk -= nr;
+		INIT_LIST_HEAD(&walk.dispose);
+		walk.seen = 0;
+		list_lru_walk(&sb->s_dentry_lru, dentry_lru_isolate_negative,
+			      &walk, walk.skip + nr);
+		shrink_dentry_list(&walk.dispose);
+		cond_resched();
+	}
+	up_read(&sb->s_umount);
+}
+
 /**
  * shrink_dcache_sb - shrink dcache for a superblock
  * @sb: superblock
@@ -1975,7 +2094,7 @@ static void __d_instantiate(struct dentry *dentry, struct inode *inode)
 	 * Decrement negative dentry count if it was in the LRU list.
 	 */
 	if (dentry->d_flags & DCACHE_LRU_LIST)
-		this_cpu_dec(nr_dentry_negative);
+		d_negative_dec(dentry);
 	hlist_add_head(&dentry->d_u.d_alias, &inode->i_dentry);
 	raw_write_seqcount_begin(&dentry->d_seq);
 	__d_set_inode_and_type(dentry, inode, add_flags);
@@ -36,6 +36,9 @@ typedef tagptr1_t compressed_page_t;
 #define tag_compressed_page_justfound(page) \
 	tagptr_fold(compressed_page_t, page, 1)
 
+/* max pclusters decompressed by one worker before the chain is split */
+#define Z_EROFS_DECOMPRESS_BATCH	8
+
 static struct workqueue_struct *z_erofs_workqueue __read_mostly;
 static struct kmem_cache *pcluster_cachep __read_mostly;
 
@@ -978,6 +981,48 @@ static void z_erofs_decompress_queue(const struct z_erofs_decompressqueue *io,
 	}
 }
 
+static void z_erofs_decompressqueue_work(struct work_struct *work);
+
+/*
+ * Keep the first Z_EROFS_DECOMPRESS_BATCH pclusters of a long chain for the
+ * current worker and hand the rest over to another one, which does the same.
+ * Large sequential reads are thus decompressed on several CPUs in parallel
+ * rather than by a single kworker.
+ */
+static void z_erofs_decompressqueue_split(struct z_erofs_decompressqueue *io)
+{
+	z_erofs_next_pcluster_t owned = io->head;
+	struct z_erofs_pcluster *pcl = NULL;
+	struct z_erofs_decompressqueue *q;
+	unsigned int nr = 0;
+
+	while (owned != Z_EROFS_PCLUSTER_TAIL_CLOSED) {
+		if (nr++ == Z_EROFS_DECOMPRESS_BATCH)
+			break;
+		pcl = container_of(owned, struct z_erofs_pcluster, next);
+		owned = READ_ONCE(pcl->next);
+	}
+
+	/* short chain, not worth another worker */
+	if (owned == Z_EROFS_PCLUSTER_TAIL_CLOSED)
+		return;
+
+	q = kvzalloc(sizeof(*q), GFP_NOWAIT | __GFP_NOWARN);
+	if (!q)
+		return;
+
+	q->sb = io->sb;
+	q->head = owned;
+	INIT_WORK(&q->u.work, z_erofs_decompressqueue_work);
+
+	/*
+	 * All pclusters are closed at this point, so nobody else can attach
+	 * to the chain and it's safe to cut it here.
+	 */
+	WRITE_ONCE(pcl->next, Z_EROFS_PCLUSTER_TAIL_CLOSED);
+	queue_work(z_erofs_workqueue, &q->u.work);
+}
+
 static void z_erofs_decompressqueue_work(struct work_struct *work)
 {
 	struct z_erofs_decompressqueue *bgq =
@@ -985,6 +1030,7 @@ static void z_erofs_decompressqueue_work(struct work_struct *work)
 	LIST_HEAD(pagepool);
 
 	DBG_BUGON(bgq->head == Z_EROFS_PCLUSTER_TAIL_CLOSED);
+	z_erofs_decompressqueue_split(bgq);
 	z_erofs_decompress_queue(bgq, &pagepool);
 
 	put_pages_list(&pagepool);
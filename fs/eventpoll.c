@@ -146,7 +146,8 @@ struct epitem {
 
 	/*
 	 * Works together "struct eventpoll"->ovflist in keeping the
-	 * single linked chain of items.
+	 * single linked chain of items.  With per-CPU ready lists, tells
+	 * whether the item is on a ready list instead, see ep_claim_ready().
 	 */
 	struct epitem *next;
 
@@ -169,6 +170,17 @@ struct epitem {
 	struct epoll_event event;
 };
 
+/*
+ * Ready list of one CPU for an eventpoll created with EPOLL_PERCPU_READY.
+ * The poll callback queues items on the list of the CPU it runs on, so
+ * wakeups from many CPUs do not all hit ep->lock.  The lock nests inside
+ * ep->lock.
+ */
+struct ep_cpu_ready {
+	spinlock_t lock;
+	struct list_head list;
+};
+
 /*
  * This structure is stored inside the "private_data" member of the file
  * structure and represents the main data structure for the eventpoll
@@ -208,6 +220,9 @@ struct eventpoll {
 	/* wakeup_source used when ep_scan_ready_list is running */
 	struct wakeup_source *ws;
 
+	/* Per-CPU ready lists, only with EPOLL_PERCPU_READY */
+	struct ep_cpu_ready __percpu *cpu_ready;
+
 	/* The user that created the eventpoll descriptor */
 	struct user_struct *user;
 
@@ -371,8 +386,112 @@ static inline struct epitem *ep_item_from_wait(wait_queue_entry_t *p)
  */
 static inline int ep_events_available(struct eventpoll *ep)
 {
-	return !list_empty_careful(&ep->rdllist) ||
-		READ_ONCE(ep->ovflist) != EP_UNACTIVE_PTR;
+	int cpu;
+
+	if (!list_empty_careful(&ep->rdllist) ||
+	    READ_ONCE(ep->ovflist) != EP_UNACTIVE_PTR)
+		return 1;
+
+	if (ep->cpu_ready) {
+		for_each_possible_cpu(cpu) {
+			if (!list_empty_careful(&per_cpu_ptr(ep->cpu_ready,
+							     cpu)->list))
+				return 1;
+		}
+	}
+	return 0;
+}
+
+/*
+ * Claim @epi for a ready list.  Normally an item is on a ready list when its
+ * rdllink is linked, which ep->lock protects.  With per-CPU ready lists the
+ * poll callback does not take ep->lock, and an item is on a ready list when
+ * it owns epi->next, which the ovflist does not use in that mode.
+ */
+static inline bool ep_claim_ready(struct eventpoll *ep, struct epitem *epi)
+{
+	if (!ep->cpu_ready)
+		return !ep_is_linked(epi);
+	return cmpxchg(&epi->next, EP_UNACTIVE_PTR, NULL) == EP_UNACTIVE_PTR;
+}
+
+/*
+ * Undo ep_claim_ready() for an item just taken off a ready list, before its
+ * ->poll() is called again.  The barrier orders the two, so a poll callback
+ * that comes in between either requeues the item or is seen by ->poll().
+ */
+static inline void ep_unclaim_ready(struct eventpoll *ep, struct epitem *epi)
+{
+	if (ep->cpu_ready)
+		smp_store_mb(epi->next, EP_UNACTIVE_PTR);
+}
+
+static void ep_cpu_ready_splice(struct ep_cpu_ready *cr,
+				struct list_head *list)
+{
+	if (list_empty_careful(&cr->list))
+		return;
+
+	spin_lock(&cr->lock);
+	list_splice_tail_init(&cr->list, list);
+	spin_unlock(&cr->lock);
+}
+
+/*
+ * Move the items of all per-CPU ready lists to @list, those of the local CPU
+ * first as their files were most likely woken here.  Called with ep->lock
+ * held for writing.
+ */
+static void ep_cpu_ready_collect(struct eventpoll *ep, struct list_head *list)
+{
+	int this_cpu = smp_processor_id();
+	int cpu;
+
+	ep_cpu_ready_splice(per_cpu_ptr(ep->cpu_ready, this_cpu), list);
+	for_each_possible_cpu(cpu) {
+		if (cpu != this_cpu)
+			ep_cpu_ready_splice(per_cpu_ptr(ep->cpu_ready, cpu),
+					    list);
+	}
+}
+
+static int ep_alloc_cpu_ready(struct eventpoll *ep)
+{
+	int cpu;
+
+	ep->cpu_ready = alloc_percpu(struct ep_cpu_ready);
+	if (!ep->cpu_ready)
+		return -ENOMEM;
+
+	for_each_possible_cpu(cpu) {
+		struct ep_cpu_ready *cr = per_cpu_ptr(ep->cpu_ready, cpu);
+
+		spin_lock_init(&cr->lock);
+		INIT_LIST_HEAD(&cr->list);
+	}
+	return 0;
+}
+
+/*
+ * Lock for adding to and removing from ep->wq in ep_poll().  The poll
+ * callback wakes ep->wq under ep->lock, except with per-CPU ready lists
+ * where it does not take ep->lock and only the waitqueue lock serializes
+ * against it.
+ */
+static inline void ep_wait_lock_irq(struct eventpoll *ep)
+{
+	if (ep->cpu_ready)
+		spin_lock_irq(&ep->wq.lock);
+	else
+		write_lock_irq(&ep->lock);
+}
+
+static inline void ep_wait_unlock_irq(struct eventpoll *ep)
+{
+	if (ep->cpu_ready)
+		spin_unlock_irq(&ep->wq.lock);
+	else
+		write_unlock_irq(&ep->lock);
 }
 
 #ifdef CONFIG_NET_RX_BUSY_POLL
@@ -613,6 +732,8 @@ static void ep_start_scan(struct eventpoll *ep, struct list_head *txlist)
 	lockdep_assert_irqs_enabled();
 	write_lock_irq(&ep->lock);
 	list_splice_init(&ep->rdllist, txlist);
+	if (ep->cpu_ready)
+		ep_cpu_ready_collect(ep, txlist);
 	WRITE_ONCE(ep->ovflist, NULL);
 	write_unlock_irq(&ep->lock);
 }
@@ -703,6 +824,13 @@ static int ep_remove(struct eventpoll *ep, struct epitem *epi)
 	rb_erase_cached(&epi->rbn, &ep->rbr);
 
 	write_lock_irq(&ep->lock);
+	/*
+	 * A ready item may be on any CPU's ready list.  Nothing can queue it
+	 * again since its poll hooks are gone, so bring them all into
+	 * ep->rdllist to unlink it.
+	 */
+	if (ep->cpu_ready && READ_ONCE(epi->next) != EP_UNACTIVE_PTR)
+		ep_cpu_ready_collect(ep, &ep->rdllist);
 	if (ep_is_linked(epi))
 		list_del_init(&epi->rdllink);
 	write_unlock_irq(&ep->lock);
@@ -771,6 +899,7 @@ static void ep_free(struct eventpoll *ep)
 	mutex_destroy(&ep->mtx);
 	free_uid(ep->user);
 	wakeup_source_unregister(ep->ws);
+	free_percpu(ep->cpu_ready);
 	kfree(ep);
 }
 
@@ -817,6 +946,7 @@ static __poll_t __ep_eventpoll_poll(struct file *file, poll_table *wait, int dep
 			 */
 			__pm_relax(ep_wakeup_source(epi));
 			list_del_init(&epi->rdllink);
+			ep_unclaim_ready(ep, epi);
 		}
 	}
 	ep_done_scan(ep, &txlist);
@@ -1117,6 +1247,10 @@ static inline bool chain_epi_lockless(struct epitem *epi)
  * single wait queue is serialized by wq.lock, but the case when multiple wait
  * queues are used should be detected accordingly.  This is detected using
  * cmpxchg() operation.
+ *
+ * With per-CPU ready lists, ep->lock is not taken at all.  The item is
+ * queued on the list of the local CPU, see ep_claim_ready(), and waiters in
+ * ep_poll() are found through a barrier rather than the lock.
  */
 static int ep_poll_callback(wait_queue_entry_t *wait, unsigned mode, int sync, void *key)
 {
@@ -1127,7 +1261,10 @@ static int ep_poll_callback(wait_queue_entry_t *wait, unsigned mode, int sync, v
 	unsigned long flags;
 	int ewake = 0;
 
-	read_lock_irqsave(&ep->lock, flags);
+	if (ep->cpu_ready)
+		local_irq_save(flags);
+	else
+		read_lock_irqsave(&ep->lock, flags);
 
 	ep_set_busy_poll_napi_id(epi);
 
@@ -1155,7 +1292,18 @@ static int ep_poll_callback(wait_queue_entry_t *wait, unsigned mode, int sync, v
 	 * semantics). All the events that happen during that period of time are
 	 * chained in ep->ovflist and requeued later on.
 	 */
-	if (READ_ONCE(ep->ovflist) != EP_UNACTIVE_PTR) {
+	if (ep->cpu_ready) {
+		if (ep_claim_ready(ep, epi)) {
+			struct ep_cpu_ready *cr = this_cpu_ptr(ep->cpu_ready);
+
+			spin_lock(&cr->lock);
+			list_add_tail(&epi->rdllink, &cr->list);
+			spin_unlock(&cr->lock);
+			ep_pm_stay_awake_rcu(epi);
+		}
+		/* Pairs with the barrier after queueing on ep->wq in ep_poll() */
+		smp_mb();
+	} else if (READ_ONCE(ep->ovflist) != EP_UNACTIVE_PTR) {
 		if (chain_epi_lockless(epi))
 			ep_pm_stay_awake_rcu(epi);
 	} else if (!ep_is_linked(epi)) {
@@ -1191,7 +1339,10 @@ static int ep_poll_callback(wait_queue_entry_t *wait, unsigned mode, int sync, v
 		pwake++;
 
 out_unlock:
-	read_unlock_irqrestore(&ep->lock, flags);
+	if (ep->cpu_ready)
+		local_irq_restore(flags);
+	else
+		read_unlock_irqrestore(&ep->lock, flags);
 
 	/* We have to call this outside the lock */
 	if (pwake)
@@ -1523,7 +1674,7 @@ static int ep_insert(struct eventpoll *ep, const struct epoll_event *event,
 	ep_set_busy_poll_napi_id(epi);
 
 	/* If the file is already "ready" we drop it inside the ready list */
-	if (revents && !ep_is_linked(epi)) {
+	if (revents && ep_claim_ready(ep, epi)) {
 		list_add_tail(&epi->rdllink, &ep->rdllist);
 		ep_pm_stay_awake(epi);
 
@@ -1599,7 +1750,7 @@ static int ep_modify(struct eventpoll *ep, struct epitem *epi,
 	 */
 	if (ep_item_poll(epi, &pt, 1)) {
 		write_lock_irq(&ep->lock);
-		if (!ep_is_linked(epi)) {
+		if (ep_claim_ready(ep, epi)) {
 			list_add_tail(&epi->rdllink, &ep->rdllist);
 			ep_pm_stay_awake(epi);
 
@@ -1668,6 +1819,7 @@ static int ep_send_events(struct eventpoll *ep,
 		}
 
 		list_del_init(&epi->rdllink);
+		ep_unclaim_ready(ep, epi);
 
 		/*
 		 * If the event mask intersect the caller-requested one,
@@ -1680,8 +1832,10 @@ static int ep_send_events(struct eventpoll *ep,
 
 		if (__put_user(revents, &events->events) ||
 		    __put_user(epi->event.data, &events->data)) {
-			list_add(&epi->rdllink, &txlist);
-			ep_pm_stay_awake(epi);
+			if (ep_claim_ready(ep, epi)) {
+				list_add(&epi->rdllink, &txlist);
+				ep_pm_stay_awake(epi);
+			}
 			if (!res)
 				res = -EFAULT;
 			break;
@@ -1700,10 +1854,13 @@ static int ep_send_events(struct eventpoll *ep,
 			 * into ep->rdllist besides us. The epoll_ctl()
 			 * callers are locked out by
 			 * ep_scan_ready_list() holding "mtx" and the
-			 * poll callback will queue them in ep->ovflist.
+			 * poll callback will queue them in ep->ovflist,
+			 * or on a per-CPU ready list if it got there first.
 			 */
-			list_add_tail(&epi->rdllink, &ep->rdllist);
-			ep_pm_stay_awake(epi);
+			if (ep_claim_ready(ep, epi)) {
+				list_add_tail(&epi->rdllink, &ep->rdllist);
+				ep_pm_stay_awake(epi);
+			}
 		}
 	}
 	ep_done_scan(ep, &txlist);
@@ -1817,7 +1974,7 @@ static int ep_poll(struct eventpoll *ep, struct epoll_event __user *events,
 		 */
 		init_wait(&wait);
 
-		write_lock_irq(&ep->lock);
+		ep_wait_lock_irq(ep);
 		/*
 		 * Barrierless variant, waitqueue_active() is called under
 		 * the same lock on wakeup ep_poll_callback() side, so it
@@ -1836,7 +1993,17 @@ static int ep_poll(struct eventpoll *ep, struct epoll_event __user *events,
 		if (!eavail)
 			__add_wait_queue_exclusive(&ep->wq, &wait);
 
-		write_unlock_irq(&ep->lock);
+		ep_wait_unlock_irq(ep);
+
+		/*
+		 * With per-CPU ready lists the callback checks
+		 * waitqueue_active() without the lock, so look again once
+		 * we are visibly on the waitqueue.
+		 */
+		if (!eavail && ep->cpu_ready) {
+			smp_mb();
+			eavail = ep_events_available(ep);
+		}
 
 		if (!eavail)
 			timed_out = !schedule_hrtimeout_range(to, slack,
@@ -1851,7 +2018,7 @@ static int ep_poll(struct eventpoll *ep, struct epoll_event __user *events,
 		eavail = 1;
 
 		if (!list_empty_careful(&wait.entry)) {
-			write_lock_irq(&ep->lock);
+			ep_wait_lock_irq(ep);
 			/*
 			 * If the thread timed out and is not on the wait queue,
 			 * it means that the thread was woken up after its
@@ -1862,7 +2029,7 @@ static int ep_poll(struct eventpoll *ep, struct epoll_event __user *events,
 			if (timed_out)
 				eavail = list_empty(&wait.entry);
 			__remove_wait_queue(&ep->wq, &wait);
-			write_unlock_irq(&ep->lock);
+			ep_wait_unlock_irq(ep);
 		}
 	}
 }
@@ -1956,8 +2123,9 @@ static int do_epoll_create(int flags)
 
 	/* Check the EPOLL_* constant for consistency.  */
 	BUILD_BUG_ON(EPOLL_CLOEXEC != O_CLOEXEC);
+	BUILD_BUG_ON(EPOLL_PERCPU_READY & O_CLOEXEC);
 
-	if (flags & ~EPOLL_CLOEXEC)
+	if (flags & ~(EPOLL_CLOEXEC | EPOLL_PERCPU_READY))
 		return -EINVAL;
 	/*
 	 * Create the internal data structure ("struct eventpoll").
@@ -1965,6 +2133,11 @@ static int do_epoll_create(int flags)
 	error = ep_alloc(&ep);
 	if (error < 0)
 		return error;
+	if (flags & EPOLL_PERCPU_READY) {
+		error = ep_alloc_cpu_ready(ep);
+		if (error)
+			goto out_free_ep;
+	}
 	/*
 	 * Creates all the items needed to setup an eventpoll file. That is,
 	 * a file structure and a free file descriptor.
@@ -1998,6 +1998,24 @@ static int do_execveat(int fd, struct filename *filename,
 	return do_execveat_common(fd, filename, argv, envp, flags);
 }
 
+/*
+ * Exec for spawn(), from the new task.  @argv and @envp are laid out as
+ * the caller of spawn() passed them, in compat layout if @compat is set.
+ */
+int spawn_execveat(int fd, struct filename *filename,
+		   const void __user *argv, const void __user *envp,
+		   int flags, bool compat)
+{
+	struct user_arg_ptr uargv = { .ptr.native = argv };
+	struct user_arg_ptr uenvp = { .ptr.native = envp };
+
+#ifdef CONFIG_COMPAT
+	uargv.is_compat = compat;
+	uenvp.is_compat = compat;
+#endif
+	return do_execveat_common(fd, filename, uargv, uenvp, flags);
+}
+
 #ifdef CONFIG_COMPAT
 static int compat_do_execve(struct filename *filename,
 	const compat_uptr_t __user *__argv,
@@ -222,6 +222,31 @@ const struct fuse_iqueue_ops fuse_dev_fiq_ops = {
 };
 EXPORT_SYMBOL_GPL(fuse_dev_fiq_ops);
 
+/*
+ * Queue the request on the submitting CPU's queue if a device is bound to
+ * that CPU, so that only a reader serving this CPU is woken.
+ */
+static bool queue_request_cpu(struct fuse_iqueue *fiq, struct fuse_req *req)
+{
+	struct fuse_iqueue_cpu *fcq;
+
+	if (!fiq->cpu_queues)
+		return false;
+
+	/* fiq->lock is held, so we can't migrate */
+	fcq = raw_cpu_ptr(fiq->cpu_queues);
+	if (!fcq->nr_devs)
+		return false;
+
+	spin_lock(&fcq->lock);
+	req->fcq = fcq;
+	list_add_tail(&req->list, &fcq->pending);
+	spin_unlock(&fcq->lock);
+	wake_up(&fcq->waitq);
+
+	return true;
+}
+
 static void queue_request_and_unlock(struct fuse_iqueue *fiq,
 				     struct fuse_req *req)
 __releases(fiq->lock)
@@ -229,6 +254,11 @@ __releases(fiq->lock)
 	req->in.h.len = sizeof(struct fuse_in_header) +
 		fuse_len_args(req->args->in_numargs,
 			      (struct fuse_arg *) req->args->in_args);
+	if (queue_request_cpu(fiq, req)) {
+		kill_fasync(&fiq->fasync, SIGIO, POLL_IN);
+		spin_unlock(&fiq->lock);
+		return;
+	}
 	list_add_tail(&req->list, &fiq->pending);
 	fiq->ops->wake_pending_and_unlock(fiq);
 }
@@ -369,6 +399,7 @@ static void request_wait_answer(struct fuse_req *req)
 {
 	struct fuse_conn *fc = req->fm->fc;
 	struct fuse_iqueue *fiq = &fc->iq;
+	struct fuse_iqueue_cpu *fcq;
 	int err;
 
 	if (!fc->no_interrupt) {
@@ -393,14 +424,22 @@ static void request_wait_answer(struct fuse_req *req)
 			return;
 
 		spin_lock(&fiq->lock);
+		/* req->fcq can only change under fiq->lock */
+		fcq = req->fcq;
+		if (fcq)
+			spin_lock(&fcq->lock);
 		/* Request is not yet in userspace, bail out */
 		if (test_bit(FR_PENDING, &req->flags)) {
 			list_del(&req->list);
+			if (fcq)
+				spin_unlock(&fcq->lock);
 			spin_unlock(&fiq->lock);
 			__fuse_put_request(req);
 			req->out.h.error = -EINTR;
 			return;
 		}
+		if (fcq)
+			spin_unlock(&fcq->lock);
 		spin_unlock(&fiq->lock);
 	}
 
@@ -1026,6 +1065,55 @@ static int request_pending(struct fuse_iqueue *fiq)
 		forget_pending(fiq);
 }
 
+static struct fuse_req *dequeue_request_cpu(struct fuse_iqueue_cpu *fcq)
+{
+	struct fuse_req *req = NULL;
+
+	spin_lock(&fcq->lock);
+	if (!list_empty(&fcq->pending)) {
+		req = list_first_entry(&fcq->pending, struct fuse_req, list);
+		clear_bit(FR_PENDING, &req->flags);
+		list_del_init(&req->list);
+	}
+	spin_unlock(&fcq->lock);
+
+	return req;
+}
+
+/*
+ * A reader bound to a CPU waits both for requests on its own queue and for
+ * shared work (interrupts, forgets and requests from CPUs without devices).
+ */
+static int fuse_dev_wait(struct fuse_iqueue *fiq, struct fuse_iqueue_cpu *fcq)
+{
+	DEFINE_WAIT(wait);
+	DEFINE_WAIT(cpu_wait);
+	int err = 0;
+
+	if (!fcq)
+		return wait_event_interruptible_exclusive(fiq->waitq,
+				!fiq->connected || request_pending(fiq));
+
+	for (;;) {
+		prepare_to_wait_exclusive(&fiq->waitq, &wait,
+					  TASK_INTERRUPTIBLE);
+		prepare_to_wait_exclusive(&fcq->waitq, &cpu_wait,
+					  TASK_INTERRUPTIBLE);
+		if (!fiq->connected || request_pending(fiq) ||
+		    !list_empty_careful(&fcq->pending))
+			break;
+		if (signal_pending(current)) {
+			err = -ERESTARTSYS;
+			break;
+		}
+		schedule();
+	}
+	finish_wait(&fcq->waitq, &cpu_wait);
+	finish_wait(&fiq->waitq, &wait);
+
+	return err;
+}
+
 /*
  * Transfer an interrupt request to userspace
  *
@@ -1195,6 +1283,7 @@ static ssize_t fuse_dev_do_read(struct fuse_dev *fud, struct file *file,
 	ssize_t err;
 	struct fuse_conn *fc = fud->fc;
 	struct fuse_iqueue *fiq = &fc->iq;
+	struct fuse_iqueue_cpu *fcq = READ_ONCE(fud->fcq);
 	struct fuse_pqueue *fpq = &fud->pq;
 	struct fuse_req *req;
 	struct fuse_args *args;
@@ -1221,6 +1310,13 @@ static ssize_t fuse_dev_do_read(struct fuse_dev *fud, struct file *file,
 
  restart:
 	for (;;) {
+		/* Interrupts take precedence over this CPU's requests */
+		if (fcq && list_empty(&fiq->interrupts)) {
+			req = dequeue_request_cpu(fcq);
+			if (req)
+				goto found;
+		}
+
 		spin_lock(&fiq->lock);
 		if (!fiq->connected || request_pending(fiq))
 			break;
@@ -1228,8 +1324,7 @@ static ssize_t fuse_dev_do_read(struct fuse_dev *fud, struct file *file,
 
 		if (file->f_flags & O_NONBLOCK)
 			return -EAGAIN;
-		err = wait_event_interruptible_exclusive(fiq->waitq,
-				!fiq->connected || request_pending(fiq));
+		err = fuse_dev_wait(fiq, fcq);
 		if (err)
 			return err;
 	}
@@ -1258,6 +1353,7 @@ static ssize_t fuse_dev_do_read(struct fuse_dev *fud, struct file *file,
 	list_del_init(&req->list);
 	spin_unlock(&fiq->lock);
 
+ found:
 	args = req->args;
 	reqsize = req->in.h.len;
 
@@ -2040,11 +2136,14 @@ static __poll_t fuse_dev_poll(struct file *file, poll_table *wait)
 
 	fiq = &fud->fc->iq;
 	poll_wait(file, &fiq->waitq, wait);
+	if (fud->fcq)
+		poll_wait(file, &fud->fcq->waitq, wait);
 
 	spin_lock(&fiq->lock);
 	if (!fiq->connected)
 		mask = EPOLLERR;
-	else if (request_pending(fiq))
+	else if (request_pending(fiq) ||
+		 (fud->fcq && !list_empty_careful(&fud->fcq->pending)))
 		mask |= EPOLLIN | EPOLLRDNORM;
 	spin_unlock(&fiq->lock);
 
@@ -2107,6 +2206,7 @@ void fuse_abort_conn(struct fuse_conn *fc)
 		struct fuse_req *req, *next;
 		LIST_HEAD(to_end);
 		unsigned int i;
+		int cpu;
 
 		/* Background queuing checks fc->connected under bg_lock */
 		spin_lock(&fc->bg_lock);
@@ -2146,6 +2246,19 @@ void fuse_abort_conn(struct fuse_conn *fc)
 		list_for_each_entry(req, &fiq->pending, list)
 			clear_bit(FR_PENDING, &req->flags);
 		list_splice_tail_init(&fiq->pending, &to_end);
+		if (fiq->cpu_queues) {
+			for_each_possible_cpu(cpu) {
+				struct fuse_iqueue_cpu *fcq;
+
+				fcq = per_cpu_ptr(fiq->cpu_queues, cpu);
+				spin_lock(&fcq->lock);
+				list_for_each_entry(req, &fcq->pending, list)
+					clear_bit(FR_PENDING, &req->flags);
+				list_splice_tail_init(&fcq->pending, &to_end);
+				spin_unlock(&fcq->lock);
+				wake_up_all(&fcq->waitq);
+			}
+		}
 		while (forget_pending(fiq))
 			kfree(fuse_dequeue_forget(fiq, 1, NULL));
 		wake_up_all(&fiq->waitq);
@@ -2169,6 +2282,74 @@ void fuse_wait_aborted(struct fuse_conn *fc)
 	wait_event(fc->blocked_waitq, atomic_read(&fc->num_waiting) == 0);
 }
 
+/*
+ * Unbind the device from its CPU.  Requests left on the queue of a CPU that
+ * no longer has devices are handed to the shared queue.
+ */
+static void fuse_dev_unbind_cpu(struct fuse_dev *fud)
+{
+	struct fuse_iqueue *fiq = &fud->fc->iq;
+	struct fuse_iqueue_cpu *fcq = fud->fcq;
+	struct fuse_req *req;
+
+	if (!fcq)
+		return;
+
+	spin_lock(&fiq->lock);
+	spin_lock(&fcq->lock);
+	if (!--fcq->nr_devs) {
+		list_for_each_entry(req, &fcq->pending, list)
+			req->fcq = NULL;
+		list_splice_tail_init(&fcq->pending, &fiq->pending);
+	}
+	spin_unlock(&fcq->lock);
+	fud->fcq = NULL;
+	if (request_pending(fiq))
+		wake_up_all(&fiq->waitq);
+	spin_unlock(&fiq->lock);
+}
+
+static int fuse_dev_bind_cpu(struct fuse_dev *fud, u32 cpu)
+{
+	struct fuse_iqueue *fiq = &fud->fc->iq;
+	struct fuse_iqueue_cpu __percpu *cpu_queues;
+	int i, err = 0;
+
+	if (cpu >= nr_cpu_ids || !cpu_possible(cpu))
+		return -EINVAL;
+
+	if (!READ_ONCE(fiq->cpu_queues)) {
+		cpu_queues = alloc_percpu(struct fuse_iqueue_cpu);
+		if (!cpu_queues)
+			return -ENOMEM;
+
+		for_each_possible_cpu(i) {
+			struct fuse_iqueue_cpu *fcq = per_cpu_ptr(cpu_queues, i);
+
+			spin_lock_init(&fcq->lock);
+			init_waitqueue_head(&fcq->waitq);
+			INIT_LIST_HEAD(&fcq->pending);
+		}
+
+		spin_lock(&fiq->lock);
+		if (!fiq->cpu_queues)
+			swap(fiq->cpu_queues, cpu_queues);
+		spin_unlock(&fiq->lock);
+		free_percpu(cpu_queues);
+	}
+
+	spin_lock(&fiq->lock);
+	if (fud->fcq) {
+		err = -EBUSY;
+	} else {
+		fud->fcq = per_cpu_ptr(fiq->cpu_queues, cpu);
+		fud->fcq->nr_devs++;
+	}
+	spin_unlock(&fiq->lock);
+
+	return err;
+}
+
 int fuse_dev_release(struct inode *inode, struct file *file)
 {
 	struct fuse_dev *fud = fuse_get_dev(file);
@@ -2179,6 +2360,8 @@ int fuse_dev_release(struct inode *inode, struct file *file)
 		LIST_HEAD(to_end);
 		unsigned int i;
 
+		fuse_dev_unbind_cpu(fud);
+
 		spin_lock(&fpq->lock);
 		WARN_ON(!list_empty(&fpq->io));
 		for (i = 0; i < FUSE_PQ_HASH_SIZE; i++)
@@ -2231,7 +2414,9 @@ static long fuse_dev_ioctl(struct file *file, unsigned int cmd,
 {
 	int res;
 	int oldfd;
+	u32 cpu;
 	struct fuse_dev *fud = NULL;
+	struct fuse_passthrough_out pto;
 
 	if (_IOC_TYPE(cmd) != FUSE_DEV_IOC_MAGIC)
 		return -ENOTTY;
@@ -2261,6 +2446,24 @@ static long fuse_dev_ioctl(struct file *file, unsigned int cmd,
 			}
 		}
 		break;
+	case _IOC_NR(FUSE_DEV_IOC_BIND_CPU):
+		res = -EFAULT;
+		if (!get_user(cpu, (__u32 __user *)arg)) {
+			res = -EINVAL;
+			fud = fuse_get_dev(file);
+			if (fud)
+				res = fuse_dev_bind_cpu(fud, cpu);
+		}
+		break;
+	case _IOC_NR(FUSE_DEV_IOC_PASSTHROUGH_OPEN):
+		res = -EFAULT;
+		if (!copy_from_user(&pto, (void __user *)arg, sizeof(pto))) {
+			res = -EINVAL;
+			fud = fuse_get_dev(file);
+			if (fud && !pto.flags)
+				res = fuse_passthrough_open(fud, pto.fd);
+		}
+		break;
 	default:
 		res = -ENOTTY;
 		break;
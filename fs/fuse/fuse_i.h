@@ -31,6 +31,7 @@
 #include <linux/pid_namespace.h>
 #include <linux/refcount.h>
 #include <linux/user_namespace.h>
+#include <linux/idr.h>
 
 /** Default max number of pages that can be used in a single read request */
 #define FUSE_DEFAULT_MAX_PAGES_PER_REQ 32
@@ -180,6 +181,12 @@ struct fuse_conn;
 struct fuse_mount;
 struct fuse_release_args;
 
+/** Backing file and credentials for a passthrough open */
+struct fuse_passthrough {
+	struct file *filp;
+	struct cred *cred;
+};
+
 /** FUSE specific file data */
 struct fuse_file {
 	/** Fuse connection for this file */
@@ -231,6 +238,9 @@ struct fuse_file {
 	/** Wait queue head for poll */
 	wait_queue_head_t poll_wait;
 
+	/** Backing file if opened in passthrough mode */
+	struct fuse_passthrough passthrough;
+
 	/** Has flock been performed on this file? */
 	bool flock:1;
 };
@@ -380,6 +390,9 @@ struct fuse_req {
 
 	/** fuse_mount this request belongs to */
 	struct fuse_mount *fm;
+
+	/** Per-CPU queue this request was put on, if any */
+	struct fuse_iqueue_cpu *fcq;
 };
 
 struct fuse_iqueue;
@@ -420,6 +433,24 @@ struct fuse_iqueue_ops {
 /** /dev/fuse input queue operations */
 extern const struct fuse_iqueue_ops fuse_dev_fiq_ops;
 
+/*
+ * Per-CPU input queue.  Requests submitted on a CPU that has devices bound to
+ * it are queued here and only wake the readers of those devices.
+ */
+struct fuse_iqueue_cpu {
+	/** Lock protecting pending */
+	spinlock_t lock;
+
+	/** Readers bound to this CPU are waiting on this */
+	wait_queue_head_t waitq;
+
+	/** Requests submitted on this CPU */
+	struct list_head pending;
+
+	/** Number of devices bound to this CPU, protected by fiq->lock */
+	unsigned int nr_devs;
+};
+
 struct fuse_iqueue {
 	/** Connection established */
 	unsigned connected;
@@ -454,6 +485,9 @@ struct fuse_iqueue {
 
 	/** Device-specific state */
 	void *priv;
+
+	/** Per-CPU queues, allocated when the first device is bound */
+	struct fuse_iqueue_cpu __percpu *cpu_queues;
 };
 
 #define FUSE_PQ_HASH_BITS 8
@@ -483,6 +517,9 @@ struct fuse_dev {
 	/** Processing queue */
 	struct fuse_pqueue pq;
 
+	/** Per-CPU input queue this device is bound to, if any */
+	struct fuse_iqueue_cpu *fcq;
+
 	/** list entry on fc->devices */
 	struct list_head entry;
 };
@@ -645,6 +682,9 @@ struct fuse_conn {
 	 */
 	unsigned handle_killpriv_v2:1;
 
+	/** Passthrough mode for read/write/mmap is enabled */
+	unsigned passthrough:1;
+
 	/*
 	 * The following bitfields are only for optimization purposes
 	 * and hence races in setting them will not cause malfunction
@@ -798,6 +838,12 @@ struct fuse_conn {
 
 	/** List of filesystems using this connection */
 	struct list_head mounts;
+
+	/** Backing files registered but not yet claimed by an open reply */
+	struct idr passthrough_req;
+
+	/** Protects passthrough_req */
+	spinlock_t passthrough_req_lock;
 };
 
 /*
@@ -1214,4 +1260,16 @@ void fuse_dax_inode_cleanup(struct inode *inode);
 bool fuse_dax_check_alignment(struct fuse_conn *fc, unsigned int map_alignment);
 void fuse_dax_cancel_work(struct fuse_conn *fc);
 
+/* passthrough.c */
+int fuse_passthrough_init(void);
+void fuse_passthrough_cleanup(void);
+int fuse_passthrough_open(struct fuse_dev *fud, u32 fd);
+int fuse_passthrough_setup(struct fuse_conn *fc, struct fuse_file *ff,
+			   struct fuse_open_out *openarg);
+void fuse_passthrough_release(struct fuse_passthrough *passthrough);
+void fuse_passthrough_conn_free(struct fuse_conn *fc);
+ssize_t fuse_passthrough_read_iter(struct kiocb *iocb, struct iov_iter *to);
+ssize_t fuse_passthrough_write_iter(struct kiocb *iocb, struct iov_iter *from);
+int fuse_passthrough_mmap(struct file *file, struct vm_area_struct *vma);
+
 #endif /* _FS_FUSE_I_H */
@@ -200,6 +200,9 @@ int inode_init_always(struct super_block *sb, struct inode *inode)
 
 #ifdef CONFIG_FSNOTIFY
 	inode->i_fsnotify_mask = 0;
+#endif
+#ifdef CONFIG_BINFMT_ELF_CACHE
+	inode->i_elf_layout = NULL;
 #endif
 	inode->i_flctx = NULL;
 	this_cpu_inc(nr_inodes);
@@ -259,6 +262,7 @@ void __destroy_inode(struct inode *inode)
 	security_inode_free(inode);
 	fsnotify_inode_delete(inode);
 	locks_free_lock_context(inode);
+	elf_layout_invalidate(inode);
 	if (!inode->i_nlink) {
 		WARN_ON(atomic_long_read(&inode->i_sb->s_remove_count) == 0);
 		atomic_long_dec(&inode->i_sb->s_remove_count);
@@ -135,6 +135,7 @@ static void nfs_readpage_release(struct nfs_page *req, int error)
 struct nfs_readdesc {
 	struct nfs_pageio_descriptor pgio;
 	struct nfs_open_context *ctx;
+	struct nfs_lock_context *l_ctx;
 };
 
 static void nfs_page_group_set_uptodate(struct nfs_page *req)
@@ -302,7 +303,7 @@ readpage_async_filler(void *data, struct page *page)
 	if (len == 0)
 		return nfs_return_empty_page(page);
 
-	new = nfs_create_request(desc->ctx, page, 0, len);
+	new = nfs_create_request_lctx(desc->l_ctx, page, 0, len);
 	if (IS_ERR(new))
 		goto out_error;
 
@@ -369,6 +370,13 @@ int nfs_readpage(struct file *file, struct page *page)
 			goto out;
 	}
 
+	desc.l_ctx = nfs_get_lock_context(desc.ctx);
+	if (IS_ERR(desc.l_ctx)) {
+		ret = PTR_ERR(desc.l_ctx);
+		put_nfs_open_context(desc.ctx);
+		goto out_unlock;
+	}
+
 	xchg(&desc.ctx->error, 0);
 	nfs_pageio_init_read(&desc.pgio, inode, false,
 			     &nfs_async_read_completion_ops);
@@ -384,6 +392,7 @@ int nfs_readpage(struct file *file, struct page *page)
 		if (!PageUptodate(page) && !ret)
 			ret = xchg(&desc.ctx->error, 0);
 	}
+	nfs_put_lock_context(desc.l_ctx);
 out:
 	put_nfs_open_context(desc.ctx);
 	return ret;
@@ -392,50 +401,60 @@ int nfs_readpage(struct file *file, struct page *page)
 	return ret;
 }
 
-int nfs_readpages(struct file *file, struct address_space *mapping,
-		struct list_head *pages, unsigned nr_pages)
+/*
+ * The pages are already in the page cache and locked.  They are handed
+ * to the pageio descriptor in order, which coalesces them into as few
+ * READs as rsize allows.  Whatever is left when we stop early is
+ * unlocked by the caller.
+ */
+void nfs_readahead(struct readahead_control *ractl)
 {
+	struct inode *inode = ractl->mapping->host;
+	struct file *file = ractl->file;
 	struct nfs_readdesc desc;
-	struct inode *inode = mapping->host;
-	int ret;
+	struct page *page;
 
-	dprintk("NFS: nfs_readpages (%s/%Lu %d)\n",
+	dprintk("NFS: nfs_readahead (%s/%Lu %u)\n",
 			inode->i_sb->s_id,
 			(unsigned long long)NFS_FILEID(inode),
-			nr_pages);
+			readahead_count(ractl));
 	nfs_inc_stats(inode, NFSIOS_VFSREADPAGES);
 
-	ret = -ESTALE;
 	if (NFS_STALE(inode))
-		goto out;
+		return;
 
 	if (file == NULL) {
-		ret = -EBADF;
 		desc.ctx = nfs_find_open_context(inode, NULL, FMODE_READ);
 		if (desc.ctx == NULL)
-			goto out;
+			return;
 	} else
 		desc.ctx = get_nfs_open_context(nfs_file_open_context(file));
 
-	/* attempt to read as many of the pages as possible from the cache
-	 * - this returns -ENOBUFS immediately if the cookie is negative
-	 */
-	ret = nfs_readpages_from_fscache(desc.ctx, inode, mapping,
-					 pages, &nr_pages);
-	if (ret == 0)
-		goto read_complete; /* all pages were read */
+	desc.l_ctx = nfs_get_lock_context(desc.ctx);
+	if (IS_ERR(desc.l_ctx))
+		goto out_put_ctx;
 
 	nfs_pageio_init_read(&desc.pgio, inode, false,
 			     &nfs_async_read_completion_ops);
 
-	ret = read_cache_pages(mapping, pages, readpage_async_filler, &desc);
+	while ((page = readahead_page(ractl)) != NULL) {
+		int ret;
 
-	nfs_pageio_complete_read(&desc.pgio, inode);
+		/* returns -ENOBUFS immediately if the cookie is negative */
+		if (nfs_readpage_from_fscache(desc.ctx, inode, page) == 0) {
+			put_page(page);
+			continue;
+		}
+		ret = readpage_async_filler(&desc, page);
+		put_page(page);
+		if (ret)
+			break;
+	}
 
-read_complete:
+	nfs_pageio_complete_read(&desc.pgio, inode);
+	nfs_put_lock_context(desc.l_ctx);
+out_put_ctx:
 	put_nfs_open_context(desc.ctx);
-out:
-	return ret;
 }
 
 int __init nfs_init_readpagecache(void)
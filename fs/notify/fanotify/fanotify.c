@@ -2,6 +2,7 @@
 #include <linux/fanotify.h>
 #include <linux/fdtable.h>
 #include <linux/fsnotify_backend.h>
+#include <linux/hash.h>
 #include <linux/init.h>
 #include <linux/jiffies.h>
 #include <linux/kernel.h> /* UINT_MAX */
@@ -14,6 +15,7 @@
 #include <linux/audit.h>
 #include <linux/sched/mm.h>
 #include <linux/statfs.h>
+#include <linux/stringhash.h>
 
 #include "fanotify.h"
 
@@ -97,7 +99,8 @@ static bool fanotify_should_merge(struct fsnotify_event *old_fsn,
 	old = FANOTIFY_E(old_fsn);
 	new = FANOTIFY_E(new_fsn);
 
-	if (old_fsn->objectid != new_fsn->objectid ||
+	if (old->hash != new->hash ||
+	    old_fsn->objectid != new_fsn->objectid ||
 	    old->type != new->type || old->pid != new->pid)
 		return false;
 
@@ -129,14 +132,17 @@ static bool fanotify_should_merge(struct fsnotify_event *old_fsn,
 	return false;
 }
 
-/* and the list better be locked by something too! */
-static int fanotify_merge(struct list_head *list, struct fsnotify_event *event)
+/* Called under notification_lock, which protects the merge hash */
+static int fanotify_merge(struct fsnotify_group *group,
+			  struct fsnotify_event *event)
 {
-	struct fsnotify_event *test_event;
-	struct fanotify_event *new;
+	struct fanotify_event *old, *new = FANOTIFY_E(event);
+	unsigned int bucket = fanotify_event_hash_bucket(new);
+	struct hlist_head *hlist = &group->fanotify_data.merge_hash[bucket];
+	int i = 0;
 
-	pr_debug("%s: list=%p event=%p\n", __func__, list, event);
-	new = FANOTIFY_E(event);
+	pr_debug("%s: group=%p event=%p bucket=%u\n", __func__,
+		 group, event, bucket);
 
 	/*
 	 * Don't merge a permission event with any other event so that we know
@@ -146,9 +152,11 @@ static int fanotify_merge(struct list_head *list, struct fsnotify_event *event)
 	if (fanotify_is_perm_event(new->mask))
 		return 0;
 
-	list_for_each_entry_reverse(test_event, list, list) {
-		if (fanotify_should_merge(test_event, event)) {
-			FANOTIFY_E(test_event)->mask |= new->mask;
+	hlist_for_each_entry(old, hlist, merge_list) {
+		if (++i > FANOTIFY_MAX_MERGE_EVENTS)
+			break;
+		if (fanotify_should_merge(&old->fse, event)) {
+			old->mask |= new->mask;
 			return 1;
 		}
 	}
@@ -156,6 +164,22 @@ static int fanotify_merge(struct list_head *list, struct fsnotify_event *event)
 	return 0;
 }
 
+/* Add a newly queued event to the merge hash, under notification_lock */
+static void fanotify_insert_event(struct fsnotify_group *group,
+				  struct fsnotify_event *fsn_event)
+{
+	struct fanotify_event *event = FANOTIFY_E(fsn_event);
+	unsigned int bucket = fanotify_event_hash_bucket(event);
+
+	assert_spin_locked(&group->notification_lock);
+
+	if (!fanotify_is_hashed_event(event->mask))
+		return;
+
+	hlist_add_head(&event->merge_list,
+		       &group->fanotify_data.merge_hash[bucket]);
+}
+
 /*
  * Wait for response to permission event. The function also takes care of
  * freeing the permission event (or offloads that in case the wait is canceled
@@ -518,6 +542,32 @@ static struct fanotify_event *fanotify_alloc_name_event(struct inode *id,
 	return &fne->fae;
 }
 
+/*
+ * Everything fanotify_should_merge() requires to be equal for a merge goes
+ * into the hash, except the fids which are cheap to compare and rarely
+ * differ for the same object id.  The name goes in because many name events
+ * share the directory as object id.
+ */
+static unsigned int fanotify_event_hash(struct fanotify_event *event)
+{
+	unsigned long key = event->fse.objectid ^ (unsigned long)event->pid;
+	unsigned int hash;
+
+	hash = hash_long(key, FANOTIFY_EVENT_HASH_BITS);
+	hash ^= hash_32(event->type, FANOTIFY_EVENT_HASH_BITS);
+	if (event->type == FANOTIFY_EVENT_TYPE_FID_NAME) {
+		struct fanotify_info *info = &FANOTIFY_NE(event)->info;
+
+		if (info->name_len)
+			hash ^= hash_32(full_name_hash(NULL,
+						fanotify_info_name(info),
+						info->name_len),
+					FANOTIFY_EVENT_HASH_BITS);
+	}
+
+	return hash;
+}
+
 static struct fanotify_event *fanotify_alloc_event(struct fsnotify_group *group,
 						   u32 mask, const void *data,
 						   int data_type, struct inode *dir,
@@ -606,6 +656,7 @@ static struct fanotify_event *fanotify_alloc_event(struct fsnotify_group *group,
 		event->pid = get_pid(task_pid(current));
 	else
 		event->pid = get_pid(task_tgid(current));
+	event->hash = fanotify_event_hash(event);
 
 out:
 	set_active_memcg(old_memcg);
@@ -683,6 +734,9 @@ static int fanotify_handle_event(struct fsnotify_group *group, u32 mask,
 	if (!mask)
 		return 0;
 
+	if (!fanotify_filter_event(group, mask, data, data_type))
+		return 0;
+
 	pr_debug("%s: group=%p mask=%x\n", __func__, group, mask);
 
 	if (fanotify_is_perm_event(mask)) {
@@ -715,7 +769,8 @@ static int fanotify_handle_event(struct fsnotify_group *group, u32 mask,
 	}
 
 	fsn_event = &event->fse;
-	ret = fsnotify_add_event(group, fsn_event, fanotify_merge);
+	ret = fsnotify_add_event(group, fsn_event, fanotify_merge,
+				 fanotify_insert_event);
 	if (ret) {
 		/* Permission events shouldn't be merged */
 		BUG_ON(ret == 1 && mask & FANOTIFY_PERM_EVENTS);
@@ -738,6 +793,9 @@ static void fanotify_free_group_priv(struct fsnotify_group *group)
 {
 	struct user_struct *user;
 
+	fanotify_free_filter(group);
+	kfree(group->fanotify_data.merge_hash);
+
 	user = group->fanotify_data.user;
 	atomic_dec(&user->fanotify_listeners);
 	free_uid(user);
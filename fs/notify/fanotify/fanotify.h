@@ -3,6 +3,7 @@
 #include <linux/path.h>
 #include <linux/slab.h>
 #include <linux/exportfs.h>
+#include <linux/hashtable.h>
 
 extern struct kmem_cache *fanotify_mark_cache;
 extern struct kmem_cache *fanotify_fid_event_cachep;
@@ -135,20 +136,49 @@ enum fanotify_event_type {
 	FANOTIFY_EVENT_TYPE_PATH,
 	FANOTIFY_EVENT_TYPE_PATH_PERM,
 	FANOTIFY_EVENT_TYPE_OVERFLOW, /* struct fanotify_event */
+	__FANOTIFY_EVENT_TYPE_NUM
 };
 
+#define FANOTIFY_EVENT_TYPE_BITS \
+	(ilog2(__FANOTIFY_EVENT_TYPE_NUM - 1) + 1)
+#define FANOTIFY_EVENT_HASH_BITS \
+	(32 - FANOTIFY_EVENT_TYPE_BITS)
+
 struct fanotify_event {
 	struct fsnotify_event fse;
+	struct hlist_node merge_list;	/* in fanotify_data.merge_hash */
 	u32 mask;
-	enum fanotify_event_type type;
+	struct {
+		unsigned int type : FANOTIFY_EVENT_TYPE_BITS;
+		unsigned int hash : FANOTIFY_EVENT_HASH_BITS;
+	};
 	struct pid *pid;
 };
 
+/*
+ * Queued events are hashed by object, pid and name, so that a new event is
+ * only compared with the few queued events it could possibly merge with.
+ */
+#define FANOTIFY_HTABLE_BITS	(7)
+#define FANOTIFY_HTABLE_SIZE	(1 << FANOTIFY_HTABLE_BITS)
+#define FANOTIFY_HTABLE_MASK	(FANOTIFY_HTABLE_SIZE - 1)
+
+/* Bound on the events compared in one bucket, in case of a bad hash */
+#define FANOTIFY_MAX_MERGE_EVENTS	128
+
+static inline unsigned int fanotify_event_hash_bucket(
+						struct fanotify_event *event)
+{
+	return event->hash & FANOTIFY_HTABLE_MASK;
+}
+
 static inline void fanotify_init_event(struct fanotify_event *event,
 				       unsigned long id, u32 mask)
 {
 	fsnotify_init_event(&event->fse, id);
+	INIT_HLIST_NODE(&event->merge_list);
 	event->mask = mask;
+	event->hash = 0;
 	event->pid = NULL;
 }
 
@@ -264,6 +294,15 @@ static inline bool fanotify_is_perm_event(u32 mask)
 		mask & FANOTIFY_PERM_EVENTS;
 }
 
+/*
+ * Permission events are never merged and the overflow event is queued at
+ * most once, so neither is hashed.
+ */
+static inline bool fanotify_is_hashed_event(u32 mask)
+{
+	return !fanotify_is_perm_event(mask) && !(mask & FS_Q_OVERFLOW);
+}
+
 static inline struct fanotify_event *FANOTIFY_E(struct fsnotify_event *fse)
 {
 	return container_of(fse, struct fanotify_event, fse);
@@ -284,3 +323,37 @@ static inline struct path *fanotify_event_path(struct fanotify_event *event)
 	else
 		return NULL;
 }
+
+static inline void fanotify_unhash_event(struct fsnotify_group *group,
+					 struct fanotify_event *event)
+{
+	assert_spin_locked(&group->notification_lock);
+
+	if (!hlist_unhashed(&event->merge_list))
+		hlist_del_init(&event->merge_list);
+}
+
+#ifdef CONFIG_FANOTIFY_FILTER
+bool fanotify_filter_event(struct fsnotify_group *group, u32 mask,
+			   const void *data, int data_type);
+long fanotify_set_filter(struct fsnotify_group *group,
+			 struct fanotify_filter __user *arg);
+void fanotify_free_filter(struct fsnotify_group *group);
+#else
+static inline bool fanotify_filter_event(struct fsnotify_group *group,
+					 u32 mask, const void *data,
+					 int data_type)
+{
+	return true;
+}
+
+static inline long fanotify_set_filter(struct fsnotify_group *group,
+				       struct fanotify_filter __user *arg)
+{
+	return -ENOTTY;
+}
+
+static inline void fanotify_free_filter(struct fsnotify_group *group)
+{
+}
+#endif
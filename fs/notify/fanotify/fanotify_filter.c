@@ -0,0 +1,172 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Classic BPF filtering of fanotify events before they are queued.
+ *
+ * The program sees a struct fanotify_filter_data, loaded 32 bits at a time
+ * like seccomp filters see struct seccomp_data, and decides whether the
+ * event is worth allocating and queueing at all.
+ */
+#include <linux/fanotify.h>
+#include <linux/cred.h>
+#include <linux/filter.h>
+#include <linux/fs.h>
+#include <linux/fsnotify_backend.h>
+#include <linux/sched.h>
+#include <linux/slab.h>
+#include <linux/uaccess.h>
+
+#include "../fsnotify.h"
+#include "fanotify.h"
+
+/* Same limit as for socket and seccomp filters */
+#define FANOTIFY_FILTER_MAX_INSNS	BPF_MAXINSNS
+
+/*
+ * Loads are redirected to the fanotify_filter_data the program runs on,
+ * and must be 32-bit aligned and within it.  Only instructions that make
+ * sense without a packet are allowed.
+ */
+static int fanotify_check_filter(struct sock_filter *filter, unsigned int flen)
+{
+	int pc;
+
+	for (pc = 0; pc < flen; pc++) {
+		struct sock_filter *ftest = &filter[pc];
+		u16 code = ftest->code;
+		u32 k = ftest->k;
+
+		switch (code) {
+		case BPF_LD | BPF_W | BPF_ABS:
+			ftest->code = BPF_LDX | BPF_W | BPF_ABS;
+			if (k >= sizeof(struct fanotify_filter_data) || k & 3)
+				return -EINVAL;
+			continue;
+		case BPF_LD | BPF_W | BPF_LEN:
+			ftest->code = BPF_LD | BPF_IMM;
+			ftest->k = sizeof(struct fanotify_filter_data);
+			continue;
+		case BPF_LDX | BPF_W | BPF_LEN:
+			ftest->code = BPF_LDX | BPF_IMM;
+			ftest->k = sizeof(struct fanotify_filter_data);
+			continue;
+		case BPF_RET | BPF_K:
+		case BPF_RET | BPF_A:
+		case BPF_ALU | BPF_ADD | BPF_K:
+		case BPF_ALU | BPF_ADD | BPF_X:
+		case BPF_ALU | BPF_SUB | BPF_K:
+		case BPF_ALU | BPF_SUB | BPF_X:
+		case BPF_ALU | BPF_MUL | BPF_K:
+		case BPF_ALU | BPF_MUL | BPF_X:
+		case BPF_ALU | BPF_DIV | BPF_K:
+		case BPF_ALU | BPF_DIV | BPF_X:
+		case BPF_ALU | BPF_AND | BPF_K:
+		case BPF_ALU | BPF_AND | BPF_X:
+		case BPF_ALU | BPF_OR | BPF_K:
+		case BPF_ALU | BPF_OR | BPF_X:
+		case BPF_ALU | BPF_XOR | BPF_K:
+		case BPF_ALU | BPF_XOR | BPF_X:
+		case BPF_ALU | BPF_LSH | BPF_K:
+		case BPF_ALU | BPF_LSH | BPF_X:
+		case BPF_ALU | BPF_RSH | BPF_K:
+		case BPF_ALU | BPF_RSH | BPF_X:
+		case BPF_ALU | BPF_NEG:
+		case BPF_LD | BPF_IMM:
+		case BPF_LDX | BPF_IMM:
+		case BPF_MISC | BPF_TAX:
+		case BPF_MISC | BPF_TXA:
+		case BPF_LD | BPF_MEM:
+		case BPF_LDX | BPF_MEM:
+		case BPF_ST:
+		case BPF_STX:
+		case BPF_JMP | BPF_JA:
+		case BPF_JMP | BPF_JEQ | BPF_K:
+		case BPF_JMP | BPF_JEQ | BPF_X:
+		case BPF_JMP | BPF_JGE | BPF_K:
+		case BPF_JMP | BPF_JGE | BPF_X:
+		case BPF_JMP | BPF_JGT | BPF_K:
+		case BPF_JMP | BPF_JGT | BPF_X:
+		case BPF_JMP | BPF_JSET | BPF_K:
+		case BPF_JMP | BPF_JSET | BPF_X:
+			continue;
+		default:
+			return -EINVAL;
+		}
+	}
+	return 0;
+}
+
+/*
+ * Returns true if the event should be queued.  Called from
+ * fanotify_handle_event() inside the fsnotify_mark_srcu read section, which
+ * keeps the program alive.
+ */
+bool fanotify_filter_event(struct fsnotify_group *group, u32 mask,
+			   const void *data, int data_type)
+{
+	struct bpf_prog *prog = READ_ONCE(group->fanotify_data.filter);
+	struct fanotify_filter_data fd = {};
+	struct inode *inode;
+
+	if (!prog)
+		return true;
+
+	inode = fsnotify_data_inode(data, data_type);
+	fd.mask = mask & FANOTIFY_OUTGOING_EVENTS;
+	if (inode) {
+		fd.mode = inode->i_mode;
+		fd.ino = inode->i_ino;
+		fd.dev = new_encode_dev(inode->i_sb->s_dev);
+	}
+	fd.pid = task_tgid_nr(current);
+	fd.uid = from_kuid_munged(&init_user_ns, current_euid());
+
+	if (bpf_prog_run_pin_on_cpu(prog, &fd))
+		return true;
+
+	atomic_long_inc(&group->fanotify_data.filtered);
+	return false;
+}
+
+long fanotify_set_filter(struct fsnotify_group *group,
+			 struct fanotify_filter __user *arg)
+{
+	struct fanotify_filter filter;
+	struct sock_fprog fprog;
+	struct bpf_prog *prog = NULL, *old;
+	int ret;
+
+	if (copy_from_user(&filter, arg, sizeof(filter)))
+		return -EFAULT;
+	if (filter.pad)
+		return -EINVAL;
+
+	if (filter.len) {
+		if (filter.len > FANOTIFY_FILTER_MAX_INSNS)
+			return -EINVAL;
+
+		fprog.len = filter.len;
+		fprog.filter = u64_to_user_ptr(filter.filter);
+		ret = bpf_prog_create_from_user(&prog, &fprog,
+						fanotify_check_filter, false);
+		if (ret)
+			return ret;
+	}
+
+	mutex_lock(&group->mark_mutex);
+	old = group->fanotify_data.filter;
+	smp_store_release(&group->fanotify_data.filter, prog);
+	mutex_unlock(&group->mark_mutex);
+
+	if (old) {
+		/* Wait for fanotify_filter_event() callers still running it */
+		synchronize_srcu(&fsnotify_mark_srcu);
+		bpf_prog_destroy(old);
+	}
+	return 0;
+}
+
+void fanotify_free_filter(struct fsnotify_group *group)
+{
+	if (group->fanotify_data.filter)
+		bpf_prog_destroy(group->fanotify_data.filter);
+}
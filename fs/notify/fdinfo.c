@@ -145,6 +145,12 @@ void fanotify_show_fdinfo(struct seq_file *m, struct file *f)
 
 	seq_printf(m, "fanotify flags:%x event-flags:%x\n",
 		   group->fanotify_data.flags, group->fanotify_data.f_flags);
+	seq_printf(m, "fanotify overflows:%lu\n", READ_ONCE(group->q_overflows));
+#ifdef CONFIG_FANOTIFY_FILTER
+	if (READ_ONCE(group->fanotify_data.filter))
+		seq_printf(m, "fanotify filtered:%lu\n",
+			   atomic_long_read(&group->fanotify_data.filtered));
+#endif
 
 	show_fdinfo(m, f, fanotify_fdinfo);
 }
@@ -139,8 +139,9 @@ static int ovl_copy_up_data(struct ovl_fs *ofs, struct path *old,
 	loff_t new_pos = 0;
 	loff_t cloned;
 	loff_t data_pos = -1;
-	loff_t hole_len;
+	loff_t hole_pos = 0;
 	bool skip_hole = false;
+	bool copy_range;
 	int error = 0;
 
 	if (len == 0)
@@ -167,6 +168,16 @@ static int ovl_copy_up_data(struct ovl_fs *ofs, struct path *old,
 	    old_file->f_op->llseek)
 		skip_hole = true;
 
+	/*
+	 * Let the filesystem do the copy (e.g. server side copy) if lower and
+	 * upper share a ->copy_file_range() implementation.  We call it
+	 * directly rather than through vfs_copy_file_range(), because we
+	 * already hold write access to the upper fs.
+	 */
+	copy_range = new_file->f_op->copy_file_range &&
+		     new_file->f_op->copy_file_range ==
+		     old_file->f_op->copy_file_range;
+
 	while (len) {
 		size_t this_len = OVL_COPY_UP_CHUNK_SIZE;
 		long bytes;
@@ -183,35 +194,52 @@ static int ovl_copy_up_data(struct ovl_fs *ofs, struct path *old,
 		 * Fill zero for hole will cost unnecessary disk space
 		 * and meanwhile slow down the copy-up speed, so we do
 		 * an optimization for hole during copy-up, it relies
-		 * on SEEK_DATA implementation in lower fs so if lower
-		 * fs does not support it, copy-up will behave as before.
+		 * on SEEK_DATA/SEEK_HOLE implementation in lower fs so if
+		 * lower fs does not support it, copy-up will behave as before.
 		 *
 		 * Detail logic of hole detection as below:
-		 * When we detect next data position is larger than current
-		 * position we will skip that hole, otherwise we copy
-		 * data in the size of OVL_COPY_UP_CHUNK_SIZE. Actually,
-		 * it may not recognize all kind of holes and sometimes
-		 * only skips partial of hole area. However, it will be
-		 * enough for most of the use cases.
+		 * When we reach the end of the current data extent, look up
+		 * the next one with SEEK_DATA and find where it ends with
+		 * SEEK_HOLE.  The hole before the extent is skipped and
+		 * chunks are trimmed so that they never run into the hole
+		 * after it.
 		 */
-
-		if (skip_hole && data_pos < old_pos) {
+		if (skip_hole && old_pos >= hole_pos) {
 			data_pos = vfs_llseek(old_file, old_pos, SEEK_DATA);
-			if (data_pos > old_pos) {
-				hole_len = data_pos - old_pos;
-				len -= hole_len;
-				old_pos = new_pos = data_pos;
-				continue;
-			} else if (data_pos == -ENXIO) {
+			if (data_pos == -ENXIO || data_pos >= old_pos + len)
 				break;
-			} else if (data_pos < 0) {
+			if (data_pos >= 0)
+				hole_pos = vfs_llseek(old_file, data_pos,
+						      SEEK_HOLE);
+			if (data_pos < 0 || hole_pos <= data_pos) {
 				skip_hole = false;
+			} else if (data_pos > old_pos) {
+				len -= data_pos - old_pos;
+				old_pos = new_pos = data_pos;
+				continue;
 			}
 		}
 
-		bytes = do_splice_direct(old_file, &old_pos,
-					 new_file, &new_pos,
-					 this_len, SPLICE_F_MOVE);
+		if (skip_hole && this_len > hole_pos - old_pos)
+			this_len = hole_pos - old_pos;
+
+		bytes = 0;
+		if (copy_range) {
+			bytes = new_file->f_op->copy_file_range(old_file,
+					old_pos, new_file, new_pos,
+					this_len, 0);
+			if (bytes > 0) {
+				old_pos += bytes;
+				new_pos += bytes;
+			} else {
+				/* Fall back to splice for the rest */
+				copy_range = false;
+			}
+		}
+		if (bytes <= 0)
+			bytes = do_splice_direct(old_file, &old_pos,
+						 new_file, &new_pos,
+						 this_len, SPLICE_F_MOVE);
 		if (bytes <= 0) {
 			error = bytes;
 			break;
@@ -37,6 +37,14 @@
  */
 unsigned int pipe_max_size = 1048576;
 
+/*
+ * The size up to which a pipe grows by itself when a writer streams into it
+ * faster than it is read, see pipe_auto_grow().  A size no larger than the
+ * default pipe size, such as the default of 0, disables growing.  Can be set
+ * by root in /proc/sys/fs/pipe-auto-max-size
+ */
+unsigned int pipe_auto_max_size;
+
 /* Maximum allocatable pages per user. Hard limit is unset by default, soft
  * matches default values.
  */
@@ -397,6 +405,50 @@ static inline bool pipe_writable(const struct pipe_inode_info *pipe)
 		!READ_ONCE(pipe->readers);
 }
 
+/*
+ * A writer that finds the pipe full while it still has at least a page to
+ * write is streaming into it.  Rather than have it sleep on every ring's
+ * worth of data, double the ring, up to pipe_auto_max_size and within the
+ * per-user limits.  Small writes, such as a jobserver's, never grow a pipe,
+ * and neither does a pipe whose size was set with F_SETPIPE_SZ.
+ *
+ * Called with the pipe locked.  Returns true if there is room to write.
+ */
+static bool pipe_auto_grow(struct pipe_inode_info *pipe, size_t remaining)
+{
+	unsigned int max_size = READ_ONCE(pipe_auto_max_size);
+	unsigned int nr_slots = pipe->max_usage * 2;
+	unsigned long user_bufs;
+
+	if (!pipe->auto_grow || remaining < PAGE_SIZE)
+		return false;
+
+	if (max_size > READ_ONCE(pipe_max_size) && pipe_is_unprivileged_user())
+		max_size = READ_ONCE(pipe_max_size);
+	if (nr_slots > max_size >> PAGE_SHIFT) {
+		pipe->auto_grow = false;
+		return false;
+	}
+
+	user_bufs = account_pipe_buffers(pipe->user, pipe->nr_accounted, nr_slots);
+	if ((too_many_pipe_buffers_hard(user_bufs) ||
+	     too_many_pipe_buffers_soft(user_bufs)) &&
+	    pipe_is_unprivileged_user())
+		goto out_revert_acct;
+
+	if (nr_slots > pipe->ring_size && pipe_resize_ring(pipe, nr_slots) < 0)
+		goto out_revert_acct;
+
+	pipe->max_usage = nr_slots;
+	pipe->nr_accounted = nr_slots;
+	return true;
+
+out_revert_acct:
+	(void) account_pipe_buffers(pipe->user, nr_slots, pipe->nr_accounted);
+	pipe->auto_grow = false;
+	return false;
+}
+
 static ssize_t
 pipe_write(struct kiocb *iocb, struct iov_iter *from)
 {
@@ -534,6 +586,9 @@ pipe_write(struct kiocb *iocb, struct iov_iter *from)
 		if (!pipe_full(head, pipe->tail, pipe->max_usage))
 			continue;
 
+		if (pipe_auto_grow(pipe, iov_iter_count(from)))
+			continue;
+
 		/* Wait for buffer space to become available. */
 		if (filp->f_flags & O_NONBLOCK) {
 			if (!ret)
@@ -798,6 +853,7 @@ struct pipe_inode_info *alloc_pipe_info(void)
 		pipe->max_usage = pipe_bufs;
 		pipe->ring_size = pipe_bufs;
 		pipe->nr_accounted = pipe_bufs;
+		pipe->auto_grow = pipe_bufs == PIPE_DEF_BUFFERS;
 		pipe->user = user;
 		mutex_init(&pipe->mutex);
 		return pipe;
@@ -1335,6 +1391,7 @@ static long pipe_set_size(struct pipe_inode_info *pipe, unsigned long arg)
 
 	pipe->max_usage = nr_slots;
 	pipe->nr_accounted = nr_slots;
+	pipe->auto_grow = false;
 	return pipe->max_usage * PAGE_SIZE;
 
 out_revert_acct:
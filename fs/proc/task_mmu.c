@@ -722,18 +722,18 @@ static const struct mm_walk_ops smaps_shmem_walk_ops = {
 };
 
 /*
- * Gather mem stats from @vma with the indicated beginning
- * address @start, and keep them in @mss.
- *
- * Use vm_start of @vma as the beginning address if @start is 0.
+ * Gather mem stats for the range [@start, @end) of @vma, and keep them in
+ * @mss.  smaps_rollup walks big vmas in pieces, so that it can drop
+ * mmap_lock in between.
  */
 static void smap_gather_stats(struct vm_area_struct *vma,
-		struct mem_size_stats *mss, unsigned long start)
+		struct mem_size_stats *mss, unsigned long start,
+		unsigned long end)
 {
 	const struct mm_walk_ops *ops = &smaps_walk_ops;
 
 	/* Invalid start */
-	if (start >= vma->vm_end)
+	if (start >= end)
 		return;
 
 #ifdef CONFIG_SHMEM
@@ -750,22 +750,39 @@ static void smap_gather_stats(struct vm_area_struct *vma,
 		 * Unless we know that the shmem object (or the part mapped by
 		 * our VMA) has no swapped out pages at all.
 		 */
-		unsigned long shmem_swapped = shmem_swap_usage(vma);
+		bool whole = (vma->vm_flags & VM_SHARED) ||
+			     !(vma->vm_flags & VM_WRITE);
+		unsigned long shmem_swapped;
 
-		if (!start && (!shmem_swapped || (vma->vm_flags & VM_SHARED) ||
-					!(vma->vm_flags & VM_WRITE))) {
+		/*
+		 * shmem_swap_usage() costs as much as the vma is big, so only
+		 * call it for the first piece.  Shared swap is counted there
+		 * for the whole vma.  Later pieces of private mappings check
+		 * their own holes instead.
+		 */
+		if (start != vma->vm_start) {
+			if (!whole) {
+				mss->check_shmem_swap = true;
+				ops = &smaps_shmem_walk_ops;
+			}
+			goto walk;
+		}
+
+		shmem_swapped = shmem_swap_usage(vma);
+		if (whole || !shmem_swapped) {
 			mss->swap += shmem_swapped;
 		} else {
 			mss->check_shmem_swap = true;
 			ops = &smaps_shmem_walk_ops;
 		}
 	}
+walk:
 #endif
 	/* mmap_lock is held in m_start */
-	if (!start)
+	if (start == vma->vm_start && end == vma->vm_end)
 		walk_page_vma(vma, ops, mss);
 	else
-		walk_page_range(vma->vm_mm, start, vma->vm_end, ops, mss);
+		walk_page_range(vma->vm_mm, start, end, ops, mss);
 }
 
 #define SEQ_PUT_DEC(str, val) \
@@ -817,7 +834,7 @@ static int show_smap(struct seq_file *m, void *v)
 
 	memset(&mss, 0, sizeof(mss));
 
-	smap_gather_stats(vma, &mss, 0);
+	smap_gather_stats(vma, &mss, vma->vm_start, vma->vm_end);
 
 	show_map_vma(m, vma);
 
@@ -866,8 +883,16 @@ static int show_smaps_rollup(struct seq_file *m, void *v)
 	hold_task_mempolicy(priv);
 
 	for (vma = priv->mm->mmap; vma;) {
-		smap_gather_stats(vma, &mss, 0);
-		last_vma_end = vma->vm_end;
+		/*
+		 * Walk at most a PUD's worth at a time, so that a huge vma
+		 * doesn't keep writers (and page faults queued behind them)
+		 * waiting for the whole walk.
+		 */
+		unsigned long start = max(last_vma_end, vma->vm_start);
+		unsigned long end = pud_addr_end(start, vma->vm_end);
+
+		smap_gather_stats(vma, &mss, start, end);
+		last_vma_end = end;
 
 		/*
 		 * Release mmap_lock temporarily if someone wants to
@@ -882,56 +907,17 @@ static int show_smaps_rollup(struct seq_file *m, void *v)
 			}
 
 			/*
-			 * After dropping the lock, there are four cases to
-			 * consider. See the following example for explanation.
-			 *
-			 *   +------+------+-----------+
-			 *   | VMA1 | VMA2 | VMA3      |
-			 *   +------+------+-----------+
-			 *   |      |      |           |
-			 *  4k     8k     16k         400k
-			 *
-			 * Suppose we drop the lock after reading VMA2 due to
-			 * contention, then we get:
-			 *
-			 *	last_vma_end = 16k
-			 *
-			 * 1) VMA2 is freed, but VMA3 exists:
-			 *
-			 *    find_vma(mm, 16k - 1) will return VMA3.
-			 *    In this case, just continue from VMA3.
-			 *
-			 * 2) VMA2 still exists:
-			 *
-			 *    find_vma(mm, 16k - 1) will return VMA2.
-			 *    Iterate the loop like the original one.
-			 *
-			 * 3) No more VMAs can be found:
-			 *
-			 *    find_vma(mm, 16k - 1) will return NULL.
-			 *    No more things to do, just break.
-			 *
-			 * 4) (last_vma_end - 1) is the middle of a vma (VMA'):
-			 *
-			 *    find_vma(mm, 16k - 1) will return VMA' whose range
-			 *    contains last_vma_end.
-			 *    Iterate VMA' from last_vma_end.
+			 * After dropping the lock, the vmas may have changed.
+			 * Carry on from the first vma that ends after the
+			 * last address walked: if it starts below that, only
+			 * its remainder is walked.
 			 */
-			vma = find_vma(mm, last_vma_end - 1);
-			/* Case 3 above */
-			if (!vma)
-				break;
-
-			/* Case 1 above */
-			if (vma->vm_start >= last_vma_end)
-				continue;
-
-			/* Case 4 above */
-			if (vma->vm_end > last_vma_end)
-				smap_gather_stats(vma, &mss, last_vma_end);
+			vma = find_vma(mm, last_vma_end);
+			continue;
 		}
-		/* Case 2 above */
-		vma = vma->vm_next;
+		if (end == vma->vm_end)
+			vma = vma->vm_next;
+		cond_resched();
 	}
 
 	show_vma_header_prefix(m, priv->mm->mmap->vm_start,
@@ -39,6 +39,7 @@
 #include "squashfs_fs_sb.h"
 #include "squashfs_fs_i.h"
 #include "squashfs.h"
+#include "page_actor.h"
 
 /*
  * Locate cache slot in range [offset, index] for specified inode.  If
@@ -494,7 +495,94 @@ static int squashfs_readpage(struct file *file, struct page *page)
 	return 0;
 }
 
+/*
+ * Decompress whole datablocks of the readahead window straight into the
+ * page cache, without going through the read_page cache buffer.  Partial
+ * datablocks at the edges of the window, sparse blocks, the fragment and
+ * blocks that fail to decompress are left for squashfs_readpage().
+ */
+static void squashfs_readahead(struct readahead_control *ractl)
+{
+	struct inode *inode = ractl->mapping->host;
+	struct squashfs_sb_info *msblk = inode->i_sb->s_fs_info;
+	int shift = msblk->block_log - PAGE_SHIFT;
+	unsigned int max_pages = 1U << shift;
+	int file_end = i_size_read(inode) >> msblk->block_log;
+	pgoff_t next = readahead_index(ractl);
+	struct squashfs_page_actor *actor;
+	unsigned int nr_pages, i;
+	struct page **pages;
+
+	pages = kmalloc_array(max_pages, sizeof(void *), GFP_KERNEL);
+	if (!pages)
+		return;
+
+	for (;;) {
+		int index, expected, bsize, res;
+		u64 block = 0;
+
+		/* Never let a batch straddle two datablocks */
+		nr_pages = __readahead_batch(ractl, pages,
+					     max_pages - (next & (max_pages - 1)));
+		if (!nr_pages)
+			break;
+		next += nr_pages;
+
+		index = pages[0]->index >> shift;
+		if ((pages[0]->index & (max_pages - 1)) || index > file_end)
+			goto skip_pages;
+
+		if (index == file_end) {
+			if (squashfs_i(inode)->fragment_block !=
+						SQUASHFS_INVALID_BLK)
+				goto skip_pages;
+			expected = i_size_read(inode) & (msblk->block_size - 1);
+		} else
+			expected = msblk->block_size;
+
+		if (!expected ||
+		    nr_pages < (expected + PAGE_SIZE - 1) >> PAGE_SHIFT)
+			goto skip_pages;
+
+		bsize = read_blocklist(inode, index, &block);
+		if (bsize <= 0)
+			goto skip_pages;
+
+		actor = squashfs_page_actor_init_special(pages, nr_pages, 0);
+		if (!actor)
+			goto skip_pages;
+
+		res = squashfs_read_data(inode->i_sb, block, bsize, NULL, actor);
+		kfree(actor);
+
+		if (res == expected) {
+			/* Last page may have trailing bytes not filled */
+			int bytes = res % PAGE_SIZE;
+
+			if (bytes) {
+				void *pageaddr = kmap_atomic(pages[nr_pages - 1]);
+
+				memset(pageaddr + bytes, 0, PAGE_SIZE - bytes);
+				kunmap_atomic(pageaddr);
+			}
+
+			for (i = 0; i < nr_pages; i++) {
+				flush_dcache_page(pages[i]);
+				SetPageUptodate(pages[i]);
+			}
+		}
+
+skip_pages:
+		for (i = 0; i < nr_pages; i++) {
+			unlock_page(pages[i]);
+			put_page(pages[i]);
+		}
+	}
+
+	kfree(pages);
+}
 
 const struct address_space_operations squashfs_aops = {
-	.readpage = squashfs_readpage
+	.readpage = squashfs_readpage,
+	.readahead = squashfs_readahead
 };
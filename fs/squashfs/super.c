@@ -194,8 +194,14 @@ static int squashfs_fill_super(struct super_block *sb, struct fs_context *fc)
 
 	err = -ENOMEM;
 
+	/*
+	 * Readers block in squashfs_cache_get() once all entries are in use,
+	 * so give the metadata and fragment caches room for every reader that
+	 * can decompress concurrently.
+	 */
 	msblk->block_cache = squashfs_cache_init("metadata",
-			SQUASHFS_CACHED_BLKS, SQUASHFS_METADATA_SIZE);
+			max(SQUASHFS_CACHED_BLKS, squashfs_max_decompressors()),
+			SQUASHFS_METADATA_SIZE);
 	if (msblk->block_cache == NULL)
 		goto failed_mount;
 
@@ -269,8 +275,11 @@ static int squashfs_fill_super(struct super_block *sb, struct fs_context *fc)
 	if (fragments == 0)
 		goto check_directory_table;
 
+	/* Fragment entries are a whole block each, don't go overboard */
 	msblk->fragment_cache = squashfs_cache_init("fragment",
-		SQUASHFS_CACHED_FRAGMENTS, msblk->block_size);
+		max(SQUASHFS_CACHED_FRAGMENTS,
+		    min(squashfs_max_decompressors(), SQUASHFS_CACHED_BLKS)),
+		msblk->block_size);
 	if (msblk->fragment_cache == NULL) {
 		err = -ENOMEM;
 		goto failed_mount;
@@ -158,6 +158,33 @@ int vfs_fstat(int fd, struct kstat *stat)
 	return error;
 }
 
+static int vfs_statx_path(const struct path *path, int flags,
+			  struct kstat *stat, u32 request_mask)
+{
+	int error;
+
+	error = vfs_getattr(path, stat, request_mask, flags);
+	stat->mnt_id = real_mount(path->mnt)->mnt_id;
+	stat->result_mask |= STATX_MNT_ID;
+	if (path->mnt->mnt_root == path->dentry)
+		stat->attributes |= STATX_ATTR_MOUNT_ROOT;
+	stat->attributes_mask |= STATX_ATTR_MOUNT_ROOT;
+	return error;
+}
+
+static unsigned int statx_lookup_flags(int flags)
+{
+	unsigned int lookup_flags = 0;
+
+	if (!(flags & AT_SYMLINK_NOFOLLOW))
+		lookup_flags |= LOOKUP_FOLLOW;
+	if (!(flags & AT_NO_AUTOMOUNT))
+		lookup_flags |= LOOKUP_AUTOMOUNT;
+	if (flags & AT_EMPTY_PATH)
+		lookup_flags |= LOOKUP_EMPTY;
+	return lookup_flags;
+}
+
 /**
  * vfs_statx - Get basic and extra attributes by filename
  * @dfd: A file descriptor representing the base dir for a relative filename
@@ -177,31 +204,20 @@ static int vfs_statx(int dfd, const char __user *filename, int flags,
 	      struct kstat *stat, u32 request_mask)
 {
 	struct path path;
-	unsigned lookup_flags = 0;
+	unsigned lookup_flags;
 	int error;
 
 	if (flags & ~(AT_SYMLINK_NOFOLLOW | AT_NO_AUTOMOUNT | AT_EMPTY_PATH |
 		      AT_STATX_SYNC_TYPE))
 		return -EINVAL;
 
-	if (!(flags & AT_SYMLINK_NOFOLLOW))
-		lookup_flags |= LOOKUP_FOLLOW;
-	if (!(flags & AT_NO_AUTOMOUNT))
-		lookup_flags |= LOOKUP_AUTOMOUNT;
-	if (flags & AT_EMPTY_PATH)
-		lookup_flags |= LOOKUP_EMPTY;
-
+	lookup_flags = statx_lookup_flags(flags);
 retry:
 	error = user_path_at(dfd, filename, lookup_flags, &path);
 	if (error)
 		goto out;
 
-	error = vfs_getattr(&path, stat, request_mask, flags);
-	stat->mnt_id = real_mount(path.mnt)->mnt_id;
-	stat->result_mask |= STATX_MNT_ID;
-	if (path.mnt->mnt_root == path.dentry)
-		stat->attributes |= STATX_ATTR_MOUNT_ROOT;
-	stat->attributes_mask |= STATX_ATTR_MOUNT_ROOT;
+	error = vfs_statx_path(&path, flags, stat, request_mask);
 	path_put(&path);
 	if (retry_estale(error, lookup_flags)) {
 		lookup_flags |= LOOKUP_REVAL;
@@ -613,6 +629,204 @@ SYSCALL_DEFINE5(statx,
 	return do_statx(dfd, filename, flags, mask, buffer);
 }
 
+/*
+ * State kept across the entries of one statx_batch() call.  Consecutive names
+ * usually live in the same directory, so the directory of the previous name
+ * is kept around and only the last component of the next name is looked up
+ * in it when the directory parts of both names are identical.
+ */
+struct statx_batch {
+	int dfd;
+	int flags;
+	unsigned int lookup_flags;
+	char *name;		/* the current name, PATH_MAX bytes */
+	char *dir;		/* directory part of the previous name */
+	int dir_len;		/* its length, -1 if there is none yet */
+	int dir_error;		/* result of looking @dir up */
+	struct path dir_path;	/* @dir, if @dir_error is 0 */
+};
+
+static void statx_batch_put_dir(struct statx_batch *batch)
+{
+	if (batch->dir_len >= 0 && !batch->dir_error)
+		path_put(&batch->dir_path);
+	batch->dir_len = -1;
+}
+
+/* Walk the whole name, like statx() would */
+static int statx_batch_lookup_slow(struct statx_batch *batch,
+				   unsigned int lookup_flags, struct path *path)
+{
+	if (!*batch->name && !(batch->flags & AT_EMPTY_PATH))
+		return -ENOENT;
+
+	return filename_lookup(batch->dfd, getname_kernel(batch->name),
+			       lookup_flags, path, NULL);
+}
+
+static int statx_batch_lookup(struct statx_batch *batch, struct path *path)
+{
+	char *name = batch->name;
+	char *last = strrchr(name, '/');
+	int dir_len;
+	int error;
+
+	if (!last) {
+		dir_len = 0;
+		last = name;
+	} else {
+		dir_len = last - name ?: 1;	/* keep the "/" of "/foo" */
+		last++;
+	}
+
+	/*
+	 * Only a plain last component can be looked up from the cached
+	 * directory; "." and ".." and trailing slashes take the full walk.
+	 */
+	if (!*last || (last[0] == '.' &&
+		       (!last[1] || (last[1] == '.' && !last[2]))))
+		return statx_batch_lookup_slow(batch, batch->lookup_flags, path);
+
+	if (dir_len != batch->dir_len || memcmp(name, batch->dir, dir_len)) {
+		statx_batch_put_dir(batch);
+		memcpy(batch->dir, name, dir_len);
+		batch->dir[dir_len] = '\0';
+		batch->dir_error = filename_lookup(batch->dfd,
+				getname_kernel(dir_len ? batch->dir : "."),
+				LOOKUP_FOLLOW | LOOKUP_DIRECTORY,
+				&batch->dir_path, NULL);
+		batch->dir_len = dir_len;
+	}
+	if (batch->dir_error)
+		return batch->dir_error;
+
+	/*
+	 * vfs_path_lookup() treats the directory as the root, so a symlink
+	 * in the last component has to be followed by the full walk instead.
+	 */
+	error = vfs_path_lookup(batch->dir_path.dentry, batch->dir_path.mnt, last,
+				batch->lookup_flags & ~LOOKUP_FOLLOW, path);
+	if (!error && (batch->lookup_flags & LOOKUP_FOLLOW) &&
+	    d_is_symlink(path->dentry)) {
+		path_put(path);
+		error = statx_batch_lookup_slow(batch, batch->lookup_flags, path);
+	}
+	return error;
+}
+
+static int statx_batch_one(struct statx_batch *batch,
+			   struct statx_batch_entry __user *uentry,
+			   unsigned int mask)
+{
+	struct statx_batch_entry entry;
+	struct kstat stat;
+	struct path path;
+	long len;
+	int error;
+
+	if (copy_from_user(&entry, uentry, sizeof(entry)))
+		return -EFAULT;
+
+	len = strncpy_from_user(batch->name, u64_to_user_ptr(entry.pathname),
+				PATH_MAX);
+	if (len < 0)
+		return len;
+
+	error = -ENAMETOOLONG;
+	if (len == PATH_MAX)
+		goto out;
+
+	error = statx_batch_lookup(batch, &path);
+	if (!error) {
+		error = vfs_statx_path(&path, batch->flags, &stat, mask);
+		path_put(&path);
+	}
+
+	/*
+	 * Like vfs_statx(), retry a stale result once with revalidation.  The
+	 * cached directory may be what went stale, so walk the whole name.
+	 */
+	if (retry_estale(error, batch->lookup_flags)) {
+		statx_batch_put_dir(batch);
+		error = statx_batch_lookup_slow(batch,
+				batch->lookup_flags | LOOKUP_REVAL, &path);
+		if (!error) {
+			error = vfs_statx_path(&path, batch->flags, &stat, mask);
+			path_put(&path);
+		}
+	}
+	if (!error)
+		error = cp_statx(&stat, u64_to_user_ptr(entry.buffer));
+out:
+	if (put_user(error, &uentry->result))
+		return -EFAULT;
+	return 0;
+}
+
+/**
+ * sys_statx_batch - System call to get enhanced stats of many files
+ * @dfd: Base directory to pathwalk from.
+ * @entries: Array of names, result buffers and per-name result codes.
+ * @nr: Number of entries in @entries.
+ * @flags: AT_* flags to control pathwalk, as for statx().
+ * @mask: Parts of statx struct actually required.
+ *
+ * Names that share their directory part with the name before them are
+ * looked up relative to the directory found for the earlier name, without
+ * walking the common prefix again.  Callers should sort names so that
+ * entries of the same directory are adjacent.
+ *
+ * Returns the number of entries processed, which is less than @nr if a
+ * fatal signal arrived or an entry could not be accessed.  The result of
+ * each processed entry is stored in its result field.
+ */
+SYSCALL_DEFINE5(statx_batch,
+		int, dfd, struct statx_batch_entry __user *, entries,
+		unsigned int, nr, unsigned int, flags, unsigned int, mask)
+{
+	struct statx_batch batch;
+	unsigned int i;
+	int error = 0;
+
+	if (mask & STATX__RESERVED)
+		return -EINVAL;
+	if ((flags & AT_STATX_SYNC_TYPE) == AT_STATX_SYNC_TYPE)
+		return -EINVAL;
+	if (flags & ~(AT_SYMLINK_NOFOLLOW | AT_NO_AUTOMOUNT | AT_EMPTY_PATH |
+		      AT_STATX_SYNC_TYPE))
+		return -EINVAL;
+
+	batch.name = __getname();
+	if (!batch.name)
+		return -ENOMEM;
+	batch.dir = __getname();
+	if (!batch.dir) {
+		__putname(batch.name);
+		return -ENOMEM;
+	}
+	batch.dfd = dfd;
+	batch.flags = flags;
+	batch.lookup_flags = statx_lookup_flags(flags);
+	batch.dir_len = -1;
+
+	for (i = 0; i < nr; i++) {
+		if (fatal_signal_pending(current)) {
+			error = -EINTR;
+			break;
+		}
+		error = statx_batch_one(&batch, &entries[i], mask);
+		if (error)
+			break;
+		cond_resched();
+	}
+
+	statx_batch_put_dir(&batch);
+	__putname(batch.dir);
+	__putname(batch.name);
+
+	return i ? i : error;
+}
+
 #ifdef CONFIG_COMPAT
 static int cp_compat_stat(struct kstat *stat, struct compat_stat __user *ubuf)
 {
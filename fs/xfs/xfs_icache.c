@@ -18,6 +18,7 @@
 #include "xfs_quota.h"
 #include "xfs_trace.h"
 #include "xfs_icache.h"
+#include "xfs_bmap.h"
 #include "xfs_bmap_util.h"
 #include "xfs_dquot_item.h"
 #include "xfs_dquot.h"
@@ -216,6 +217,7 @@ xfs_inode_set_reclaim_tag(
 			   XFS_ICI_RECLAIM_TAG);
 	xfs_perag_set_reclaim_tag(pag);
 	__xfs_iflags_set(ip, XFS_IRECLAIMABLE);
+	ip->i_flags &= ~(XFS_NEED_INACTIVE | XFS_INACTIVATING);
 
 	spin_unlock(&ip->i_flags_lock);
 	spin_unlock(&pag->pag_ici_lock);
@@ -371,6 +373,26 @@ xfs_iget_cache_hit(
 		goto out_error;
 	}
 
+	/*
+	 * If the inode is waiting for or undergoing background inactivation,
+	 * it has no VFS state left.  Unlinked inodes that are still queued are
+	 * on their way to being freed and cannot be looked up again.  Anything
+	 * else has to wait for the inodegc worker to finish with it and move
+	 * it to reclaim; in particular an inode being inactivated may already
+	 * be free on disk and about to be reallocated.
+	 */
+	if (ip->i_flags & (XFS_NEED_INACTIVE | XFS_INACTIVATING)) {
+		if (!(ip->i_flags & XFS_INACTIVATING) &&
+		    VFS_I(ip)->i_nlink == 0) {
+			error = -ENOENT;
+			goto out_error;
+		}
+		trace_xfs_iget_skip(ip);
+		XFS_STATS_INC(mp, xs_ig_frecycle);
+		error = -EAGAIN;
+		goto out_error;
+	}
+
 	/*
 	 * Check the inode free state is valid. This also detects lookup
 	 * racing with unlinks.
@@ -743,7 +765,8 @@ xfs_inode_walk_ag_grab(
 
 	/* avoid new or reclaimable inodes. Leave for reclaim code to flush */
 	if ((!newinos && __xfs_iflags_test(ip, XFS_INEW)) ||
-	    __xfs_iflags_test(ip, XFS_IRECLAIMABLE | XFS_IRECLAIM))
+	    __xfs_iflags_test(ip, XFS_IRECLAIMABLE | XFS_IRECLAIM |
+				  XFS_NEED_INACTIVE | XFS_INACTIVATING))
 		goto out_unlock_noent;
 	spin_unlock(&ip->i_flags_lock);
 
@@ -1634,10 +1657,18 @@ xfs_blockgc_free_space(
 	struct xfs_mount	*mp,
 	struct xfs_eofblocks	*eofb)
 {
+	int			error;
+
 	trace_xfs_blockgc_free_space(mp, eofb, _RET_IP_);
 
-	return xfs_inode_walk(mp, 0, xfs_blockgc_scan_inode, eofb,
+	error = xfs_inode_walk(mp, 0, xfs_blockgc_scan_inode, eofb,
 			XFS_ICI_BLOCKGC_TAG);
+	if (error)
+		return error;
+
+	/* Queued inactivations may be sitting on unlinked files' blocks. */
+	xfs_inodegc_flush(mp);
+	return 0;
 }
 
 /*
@@ -1705,3 +1736,358 @@ xfs_blockgc_free_quota(
 			xfs_inode_dquot(ip, XFS_DQTYPE_GROUP),
 			xfs_inode_dquot(ip, XFS_DQTYPE_PROJ), eof_flags);
 }
+
+#ifdef DEBUG
+static void
+xfs_check_delalloc(
+	struct xfs_inode	*ip,
+	int			whichfork)
+{
+	struct xfs_ifork	*ifp = XFS_IFORK_PTR(ip, whichfork);
+	struct xfs_bmbt_irec	got;
+	struct xfs_iext_cursor	icur;
+
+	if (!ifp || !xfs_iext_lookup_extent(ip, ifp, 0, &icur, &got))
+		return;
+	do {
+		if (isnullstartblock(got.br_startblock)) {
+			xfs_warn(ip->i_mount,
+	"ino %llx %s fork has delalloc extent at [0x%llx:0x%llx]",
+				ip->i_ino,
+				whichfork == XFS_DATA_FORK ? "data" : "cow",
+				got.br_startoff, got.br_blockcount);
+		}
+	} while (xfs_iext_next_extent(ifp, &icur, &got));
+}
+#else
+#define xfs_check_delalloc(ip, whichfork)	do { } while (0)
+#endif
+
+
+/*
+ * Hand an inode that has finished (or never needed) inactivation over to
+ * background reclaim.
+ */
+void
+xfs_inode_mark_reclaimable(
+	struct xfs_inode	*ip)
+{
+	struct xfs_mount	*mp = ip->i_mount;
+
+	if (!XFS_FORCED_SHUTDOWN(mp) && ip->i_delayed_blks) {
+		xfs_check_delalloc(ip, XFS_DATA_FORK);
+		xfs_check_delalloc(ip, XFS_COW_FORK);
+		ASSERT(0);
+	}
+
+	XFS_STATS_INC(mp, vn_reclaim);
+
+	/*
+	 * We should never get here with one of the reclaim flags already set.
+	 */
+	ASSERT_ALWAYS(!xfs_iflags_test(ip, XFS_IRECLAIMABLE));
+	ASSERT_ALWAYS(!xfs_iflags_test(ip, XFS_IRECLAIM));
+
+	/*
+	 * We always use background reclaim here because even if the inode is
+	 * clean, it still may be under IO and hence we have wait for IO
+	 * completion to occur before we can reclaim the inode. The background
+	 * reclaim path handles this more efficiently than we can here, so
+	 * simply let background reclaim tear down all inodes.
+	 */
+	xfs_inode_set_reclaim_tag(ip);
+}
+
+/*
+ * Background Inode Inactivation
+ * =============================
+ *
+ * When the VFS drops the last reference to an inode that still needs on-disk
+ * updates -- an unlinked file that must be truncated and freed, or a file
+ * with post-eof preallocations or CoW staging extents -- we don't want the
+ * task calling iput to do that work, because freeing the extents of a large
+ * file or a few million small ones can take a very long time.  Instead the
+ * inode is flagged NEED_INACTIVE and pushed onto a per-cpu lockless list,
+ * and a per-cpu work item inactivates the whole batch and then hands the
+ * inodes to background reclaim.  Queueing never touches a shared cacheline,
+ * and the worker usually finds the inodes still hot in the cache.
+ *
+ * The backlog is bounded.  Once a cpu has more than XFS_INODEGC_MAX_BACKLOG
+ * inodes queued, or the shrinker has told us memory is tight, the task doing
+ * the queueing waits for the worker to catch up.
+ *
+ * Blocks and inodes that the queued unlinked inodes will release are tracked
+ * in m_inodegc_blocks and m_inodegc_inodes so that statfs can report them as
+ * free straight away, rather than making rm -rf look like it leaks space.
+ */
+
+/* Queue depth at which we make the queueing task wait for the worker. */
+#define XFS_INODEGC_MAX_BACKLOG		(4 * XFS_INODES_PER_CHUNK)
+
+/*
+ * Blocks that inactivating this inode will return to the data device free
+ * space pool.  Realtime blocks don't live there, and shared blocks might not
+ * be released at all, so neither is counted.
+ */
+static inline xfs_filblks_t
+xfs_inodegc_pending_blocks(
+	struct xfs_inode	*ip)
+{
+	if (VFS_I(ip)->i_nlink != 0)
+		return 0;
+	if (XFS_IS_REALTIME_INODE(ip) || xfs_is_reflink_inode(ip))
+		return 0;
+	return ip->i_d.di_nblocks;
+}
+
+/*
+ * Queue an inode for background inactivation.  Returns false if the inodegc
+ * workers are not running, in which case the caller has to inactivate the
+ * inode itself.
+ */
+bool
+xfs_inodegc_queue(
+	struct xfs_inode	*ip)
+{
+	struct xfs_mount	*mp = ip->i_mount;
+	struct xfs_inodegc	*gc;
+	xfs_filblks_t		blocks;
+	unsigned int		items;
+	unsigned int		shrinker_hits;
+	int			cpu;
+
+	/*
+	 * Check the enabled bit with preemption disabled, and keep it so until
+	 * the work is queued.  xfs_inodegc_stop() waits for an RCU grace period
+	 * after clearing the bit, so every inode added to a list behind its
+	 * back is there by the time it flushes the workers.
+	 */
+	cpu = get_cpu();
+	if (!xfs_is_inodegc_enabled(mp)) {
+		put_cpu();
+		return false;
+	}
+
+	trace_xfs_inode_set_need_inactive(ip);
+	xfs_iflags_set(ip, XFS_NEED_INACTIVE);
+
+	blocks = xfs_inodegc_pending_blocks(ip);
+	if (blocks)
+		percpu_counter_add(&mp->m_inodegc_blocks, blocks);
+	if (VFS_I(ip)->i_nlink == 0)
+		percpu_counter_inc(&mp->m_inodegc_inodes);
+
+	gc = per_cpu_ptr(mp->m_inodegc, cpu);
+	llist_add(&ip->i_gclist, &gc->list);
+	items = READ_ONCE(gc->items) + 1;
+	WRITE_ONCE(gc->items, items);
+	shrinker_hits = READ_ONCE(gc->shrinker_hits);
+	queue_work_on(cpu, mp->m_inodegc_wq, &gc->work);
+	put_cpu();
+
+	/*
+	 * Throttle the task releasing inodes if the worker has fallen behind
+	 * or memory is tight.  Never wait while holding a transaction, since
+	 * the worker may need the log space we are pinning, and never wait in
+	 * memory reclaim, which must not block on filesystem progress.
+	 */
+	if (current->journal_info || (current->flags & PF_MEMALLOC))
+		return true;
+
+	if (items > XFS_INODEGC_MAX_BACKLOG || shrinker_hits > 0) {
+		trace_xfs_inodegc_throttle(mp, items, _RET_IP_);
+		flush_work(&gc->work);
+	}
+	return true;
+}
+
+/* Inactivate all the inodes queued on this cpu. */
+void
+xfs_inodegc_worker(
+	struct work_struct	*work)
+{
+	struct xfs_inodegc	*gc = container_of(work, struct xfs_inodegc,
+						work);
+	struct llist_node	*node = llist_del_all(&gc->list);
+	struct xfs_inode	*ip, *n;
+
+	WRITE_ONCE(gc->items, 0);
+	WRITE_ONCE(gc->shrinker_hits, 0);
+
+	if (!node)
+		return;
+
+	/* llist_add pushes at the head; process the oldest inodes first. */
+	node = llist_reverse_order(node);
+	llist_for_each_entry_safe(ip, n, node, i_gclist) {
+		struct xfs_mount	*mp = ip->i_mount;
+		xfs_filblks_t		blocks = xfs_inodegc_pending_blocks(ip);
+		bool			unlinked = VFS_I(ip)->i_nlink == 0;
+
+		trace_xfs_inode_inactivating(ip);
+		xfs_iflags_set(ip, XFS_INACTIVATING);
+		xfs_inactive(ip);
+
+		if (blocks)
+			percpu_counter_sub(&mp->m_inodegc_blocks, blocks);
+		if (unlinked)
+			percpu_counter_dec(&mp->m_inodegc_inodes);
+		xfs_inode_mark_reclaimable(ip);
+	}
+}
+
+/*
+ * Wait for all inodes queued for background inactivation so far to be
+ * inactivated and handed over to reclaim.
+ */
+void
+xfs_inodegc_flush(
+	struct xfs_mount	*mp)
+{
+	struct xfs_inodegc	*gc;
+	struct work_struct	*work = current_work();
+	int			cpu;
+
+	/*
+	 * Inactivation can run into ENOSPC and end up back here through
+	 * xfs_blockgc_free_space.  A worker must not wait for itself or its
+	 * siblings.
+	 */
+	if (work && work->func == xfs_inodegc_worker)
+		return;
+
+	trace_xfs_inodegc_flush(mp, 0, _RET_IP_);
+
+	for_each_possible_cpu(cpu) {
+		gc = per_cpu_ptr(mp->m_inodegc, cpu);
+		flush_work(&gc->work);
+	}
+}
+
+/*
+ * Queue the worker of every cpu that has inodes waiting.  Returns true if
+ * there were any.
+ */
+static bool
+xfs_inodegc_queue_all(
+	struct xfs_mount	*mp)
+{
+	struct xfs_inodegc	*gc;
+	bool			ret = false;
+	int			cpu;
+
+	for_each_possible_cpu(cpu) {
+		gc = per_cpu_ptr(mp->m_inodegc, cpu);
+		if (!llist_empty(&gc->list)) {
+			queue_work_on(cpu, mp->m_inodegc_wq, &gc->work);
+			ret = true;
+		}
+	}
+	return ret;
+}
+
+/*
+ * Stop queueing inodes for background inactivation and wait for the ones
+ * already queued.  Inodes released after this point are inactivated by the
+ * caller of iput, as they were before the workers existed.
+ *
+ * The caller is about to make the filesystem read-only or freeze it, after
+ * which the workers could no longer inactivate anything, so nothing may be
+ * left on the lists when we return.
+ */
+void
+xfs_inodegc_stop(
+	struct xfs_mount	*mp)
+{
+	if (!test_and_clear_bit(XFS_OPSTATE_INODEGC_ENABLED, &mp->m_opstate))
+		return;
+
+	/* Wait for xfs_inodegc_queue() calls that saw the bit still set. */
+	synchronize_rcu();
+
+	do {
+		xfs_inodegc_flush(mp);
+	} while (xfs_inodegc_queue_all(mp));
+}
+
+/* Start queueing inodes for background inactivation. */
+void
+xfs_inodegc_start(
+	struct xfs_mount	*mp)
+{
+	set_bit(XFS_OPSTATE_INODEGC_ENABLED, &mp->m_opstate);
+}
+
+/*
+ * Register a shrinker so that memory reclaim can tell us to hurry up.  Queued
+ * inodes pin their memory until the worker gets to them, and under pressure
+ * we want the tasks queueing them to wait rather than pile up more.
+ */
+#define XFS_INODEGC_SHRINKER_COUNT	(1UL << DEF_PRIORITY)
+#define XFS_INODEGC_SHRINKER_BATCH	((XFS_INODEGC_SHRINKER_COUNT / 2) + 1)
+
+static unsigned long
+xfs_inodegc_shrinker_count(
+	struct shrinker		*shrink,
+	struct shrink_control	*sc)
+{
+	struct xfs_mount	*mp = container_of(shrink, struct xfs_mount,
+						   m_inodegc_shrinker);
+	struct xfs_inodegc	*gc;
+	int			cpu;
+
+	if (!xfs_is_inodegc_enabled(mp))
+		return 0;
+
+	for_each_online_cpu(cpu) {
+		gc = per_cpu_ptr(mp->m_inodegc, cpu);
+		if (!llist_empty(&gc->list))
+			return XFS_INODEGC_SHRINKER_COUNT;
+	}
+
+	return 0;
+}
+
+static unsigned long
+xfs_inodegc_shrinker_scan(
+	struct shrinker		*shrink,
+	struct shrink_control	*sc)
+{
+	struct xfs_mount	*mp = container_of(shrink, struct xfs_mount,
+						   m_inodegc_shrinker);
+	struct xfs_inodegc	*gc;
+	int			cpu;
+
+	if (!xfs_is_inodegc_enabled(mp))
+		return SHRINK_STOP;
+
+	trace_xfs_inodegc_shrinker_scan(mp, sc->nr_to_scan, _RET_IP_);
+
+	for_each_online_cpu(cpu) {
+		gc = per_cpu_ptr(mp->m_inodegc, cpu);
+		if (llist_empty(&gc->list))
+			continue;
+
+		WRITE_ONCE(gc->shrinker_hits,
+			   READ_ONCE(gc->shrinker_hits) + 1);
+		queue_work_on(cpu, mp->m_inodegc_wq, &gc->work);
+	}
+
+	/* Nothing is freed here; the workers do that asynchronously. */
+	return SHRINK_STOP;
+}
+
+int
+xfs_inodegc_register_shrinker(
+	struct xfs_mount	*mp)
+{
+	struct shrinker		*shrink = &mp->m_inodegc_shrinker;
+
+	shrink->count_objects = xfs_inodegc_shrinker_count;
+	shrink->scan_objects = xfs_inodegc_shrinker_scan;
+	shrink->seeks = 0;
+	shrink->flags = SHRINKER_NONSLAB;
+	shrink->batch = XFS_INODEGC_SHRINKER_BATCH;
+
+	return register_shrinker(shrink);
+}
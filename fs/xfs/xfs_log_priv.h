@@ -234,13 +234,32 @@ struct xfs_cil_ctx {
 	xfs_lsn_t		start_lsn;	/* first LSN of chkpt commit */
 	xfs_lsn_t		commit_lsn;	/* chkpt commit record lsn */
 	struct xlog_ticket	*ticket;	/* chkpt ticket */
-	int			nvecs;		/* number of regions */
-	int			space_used;	/* aggregate size of regions */
+	atomic_t		space_used;	/* aggregate size of regions */
+	atomic_t		order_id;	/* item commit order counter */
 	struct list_head	busy_extents;	/* busy extents in chkpt */
+	struct list_head	log_items;	/* log items in chkpt */
 	struct xfs_log_vec	*lv_chain;	/* logvecs being pushed */
 	struct list_head	iclog_entry;
 	struct list_head	committing;	/* ctx committing list */
 	struct work_struct	discard_endio_work;
+	cpumask_t		cil_pcpmask;	/* CPUs with per-cpu CIL state */
+};
+
+/*
+ * Per-cpu CIL tracking items
+ *
+ * Transaction commits insert their log items and busy extents into the list
+ * of the CPU they run on, and account the space they use and the reservation
+ * they hand over to the checkpoint ticket here. Everything is aggregated into
+ * the context when the CIL is pushed, which holds out new commits by taking
+ * the context lock exclusively.
+ */
+struct xlog_cil_pcp {
+	int32_t			space_used;	/* bytes committed in this ctx */
+	int32_t			space_delta;	/* not yet in ctx->space_used */
+	uint32_t		space_reserved;	/* stolen for the ctx ticket */
+	struct list_head	busy_extents;
+	struct list_head	log_items;
 };
 
 /*
@@ -261,8 +280,8 @@ struct xfs_cil_ctx {
  */
 struct xfs_cil {
 	struct xlog		*xc_log;
-	struct list_head	xc_cil;
-	spinlock_t		xc_cil_lock;
+	unsigned long		xc_flags;
+	struct xlog_cil_pcp __percpu *xc_pcp;
 
 	struct rw_semaphore	xc_ctx_lock ____cacheline_aligned_in_smp;
 	struct xfs_cil_ctx	*xc_ctx;
@@ -276,6 +295,9 @@ struct xfs_cil {
 	wait_queue_head_t	xc_push_wait;	/* background push throttle */
 } ____cacheline_aligned_in_smp;
 
+/* xc_flags bit values */
+#define	XLOG_CIL_EMPTY		1
+
 /*
  * The amount of log space we allow the CIL to aggregate is difficult to size.
  * Whatever we choose, we have to make sure we can get a reservation for the
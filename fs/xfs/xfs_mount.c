@@ -1034,6 +1034,13 @@ xfs_mountfs(
 		error = xfs_fs_reserve_ag_blocks(mp);
 		if (error && error != -ENOSPC)
 			goto out_agresv;
+
+		/*
+		 * Everything is set up, so final iputs can now hand inode
+		 * inactivation off to the background workers.  Log recovery
+		 * above inactivated its unlinked inodes synchronously.
+		 */
+		xfs_inodegc_start(mp);
 	}
 
 	return 0;
@@ -1095,6 +1102,11 @@ xfs_unmountfs(
 	uint64_t		resblks;
 	int			error;
 
+	/*
+	 * Finish inactivating the inodes evicted by the VFS before we tear
+	 * down the quota and AG reservations that inactivation relies on.
+	 */
+	xfs_inodegc_stop(mp);
 	xfs_blockgc_stop(mp);
 	xfs_fs_unreserve_ag_blocks(mp);
 	xfs_qm_unmount_quotas(mp);
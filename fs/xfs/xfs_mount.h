@@ -95,6 +95,10 @@ typedef struct xfs_mount {
 	struct workqueue_struct	*m_reclaim_workqueue;
 	struct workqueue_struct *m_blockgc_workqueue;
 	struct workqueue_struct	*m_sync_workqueue;
+	struct workqueue_struct	*m_inodegc_wq;
+
+	/* per-cpu lists of inodes waiting for background inactivation */
+	struct xfs_inodegc __percpu *m_inodegc;
 
 	int			m_bsize;	/* fs logical block size */
 	uint8_t			m_blkbit_log;	/* blocklog + NBBY */
@@ -170,6 +174,12 @@ typedef struct xfs_mount {
 	 * extents or anything related to the rt device.
 	 */
 	struct percpu_counter	m_delalloc_blks;
+	/*
+	 * Blocks and inodes that will be released once the queued unlinked
+	 * inodes have been inactivated.  Reported as free space by statfs.
+	 */
+	struct percpu_counter	m_inodegc_blocks;
+	struct percpu_counter	m_inodegc_inodes;
 
 	struct radix_tree_root	m_perag_tree;	/* per-ag accounting info */
 	spinlock_t		m_perag_lock;	/* lock for m_perag_tree */
@@ -192,6 +202,12 @@ typedef struct xfs_mount {
 	 */
 	struct work_struct	m_flush_inodes_work;
 
+	/* Operational state flags, see XFS_OPSTATE_* below. */
+	unsigned long		m_opstate;
+
+	/* Kick the inodegc workers when memory gets tight. */
+	struct shrinker		m_inodegc_shrinker;
+
 	/*
 	 * Generation of the filesysyem layout.  This is incremented by each
 	 * growfs, and used by the pNFS server to ensure the client updates
@@ -217,6 +233,29 @@ typedef struct xfs_mount {
 
 #define M_IGEO(mp)		(&(mp)->m_ino_geo)
 
+/*
+ * Per-cpu deferred inode inactivation list.  Inodes are queued here by
+ * ->destroy_inode and inactivated by the work item on the same cpu.
+ */
+struct xfs_inodegc {
+	struct llist_head	list;
+	struct work_struct	work;
+
+	/* approximate count of inodes in the list */
+	unsigned int		items;
+	unsigned int		shrinker_hits;
+};
+
+/*
+ * Flags for m_opstate.  These are manipulated with atomic bitops.
+ */
+#define XFS_OPSTATE_INODEGC_ENABLED	0	/* background inactivation on */
+
+static inline bool xfs_is_inodegc_enabled(struct xfs_mount *mp)
+{
+	return test_bit(XFS_OPSTATE_INODEGC_ENABLED, &mp->m_opstate);
+}
+
 /*
  * Flags for m_flags.
  */
@@ -668,6 +668,8 @@ DEFINE_INODE_EVENT(xfs_inode_free_eofblocks_invalid);
 DEFINE_INODE_EVENT(xfs_inode_set_cowblocks_tag);
 DEFINE_INODE_EVENT(xfs_inode_clear_cowblocks_tag);
 DEFINE_INODE_EVENT(xfs_inode_free_cowblocks_invalid);
+DEFINE_INODE_EVENT(xfs_inode_set_need_inactive);
+DEFINE_INODE_EVENT(xfs_inode_inactivating);
 
 /*
  * ftrace's __print_symbolic requires that all enum values be wrapped in the
@@ -3928,6 +3930,34 @@ DEFINE_EVENT(xfs_eofblocks_class, name,	\
 DEFINE_EOFBLOCKS_EVENT(xfs_ioc_free_eofblocks);
 DEFINE_EOFBLOCKS_EVENT(xfs_blockgc_free_space);
 
+DECLARE_EVENT_CLASS(xfs_inodegc_class,
+	TP_PROTO(struct xfs_mount *mp, unsigned int items,
+		 unsigned long caller_ip),
+	TP_ARGS(mp, items, caller_ip),
+	TP_STRUCT__entry(
+		__field(dev_t, dev)
+		__field(unsigned int, items)
+		__field(unsigned long, caller_ip)
+	),
+	TP_fast_assign(
+		__entry->dev = mp->m_super->s_dev;
+		__entry->items = items;
+		__entry->caller_ip = caller_ip;
+	),
+	TP_printk("dev %d:%d items %u caller %pS",
+		  MAJOR(__entry->dev), MINOR(__entry->dev),
+		  __entry->items,
+		  (char *)__entry->caller_ip)
+);
+#define DEFINE_INODEGC_EVENT(name)	\
+DEFINE_EVENT(xfs_inodegc_class, name,	\
+	TP_PROTO(struct xfs_mount *mp, unsigned int items, \
+		 unsigned long caller_ip), \
+	TP_ARGS(mp, items, caller_ip))
+DEFINE_INODEGC_EVENT(xfs_inodegc_throttle);
+DEFINE_INODEGC_EVENT(xfs_inodegc_flush);
+DEFINE_INODEGC_EVENT(xfs_inodegc_shrinker_scan);
+
 #endif /* _TRACE_XFS_H */
 
 #undef TRACE_INCLUDE_PATH
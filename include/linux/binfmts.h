@@ -139,7 +139,46 @@ int copy_string_kernel(const char *arg, struct linux_binprm *bprm);
 extern void set_binfmt(struct linux_binfmt *new);
 extern ssize_t read_code(struct file *, unsigned long, loff_t, size_t);
 
+/*
+ * The ELF header and program headers of an executable, cached with its
+ * inode.  See fs/binfmt_elf_cache.c.
+ */
+struct elf_layout {
+	struct rcu_head rcu;
+	refcount_t refs;
+	loff_t size;
+	struct timespec64 mtime;
+	struct timespec64 ctime;
+	unsigned int ehdr_size;
+	unsigned int phdr_size;
+	char data[];		/* ELF header, then program headers */
+};
+
+#ifdef CONFIG_BINFMT_ELF_CACHE
+struct elf_layout *elf_layout_get(struct file *file);
+void elf_layout_put(struct elf_layout *layout);
+void elf_layout_add(struct file *file, const void *ehdr,
+		    unsigned int ehdr_size, const void *phdrs,
+		    unsigned int phdr_size);
+#else
+static inline struct elf_layout *elf_layout_get(struct file *file)
+{
+	return NULL;
+}
+static inline void elf_layout_put(struct elf_layout *layout)
+{
+}
+static inline void elf_layout_add(struct file *file, const void *ehdr,
+				  unsigned int ehdr_size, const void *phdrs,
+				  unsigned int phdr_size)
+{
+}
+#endif
+
 int kernel_execve(const char *filename,
 		  const char *const *argv, const char *const *envp);
+int spawn_execveat(int fd, struct filename *filename,
+		   const void __user *argv, const void __user *envp,
+		   int flags, bool compat);
 
 #endif /* _LINUX_BINFMTS_H */
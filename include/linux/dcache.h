@@ -507,6 +507,8 @@ static inline bool d_is_fallthru(const struct dentry *dentry)
 
 
 extern int sysctl_vfs_cache_pressure;
+extern unsigned long sysctl_negative_dentry_limit;
+extern void prune_negative_dentries(struct work_struct *work);
 
 static inline unsigned long vfs_pressure_ratio(unsigned long val)
 {
@@ -32,6 +32,7 @@
 #include <linux/lockdep.h>
 #include <linux/percpu-rwsem.h>
 #include <linux/workqueue.h>
+#include <linux/percpu_counter.h>
 #include <linux/delayed_call.h>
 #include <linux/uuid.h>
 #include <linux/errseq.h>
@@ -718,6 +719,10 @@ struct inode {
 	struct fsverity_info	*i_verity_info;
 #endif
 
+#ifdef CONFIG_BINFMT_ELF_CACHE
+	struct elf_layout	*i_elf_layout; /* see fs/binfmt_elf_cache.c */
+#endif
+
 	void			*i_private; /* fs or device private pointer */
 } __randomize_layout;
 
@@ -1532,6 +1537,10 @@ struct super_block {
 	struct list_lru		s_dentry_lru;
 	struct list_lru		s_inode_lru;
 	struct rcu_head		rcu;
+
+	/* Negative dentries on s_dentry_lru, and work to trim them */
+	struct percpu_counter	s_nr_dentry_negative;
+	struct work_struct	s_negative_dentry_work;
 	struct work_struct	destroy_work;
 
 	struct mutex		s_sync_lock;	/* sync serialisation lock */
@@ -2920,10 +2929,30 @@ static inline void file_end_write(struct file *file)
  * except for the cases where we don't hold i_writecount yet. Then we need to
  * use {get,deny}_write_access() - these functions check the sign and refuse
  * to do the change if sign is wrong.
+ *
+ * Getting write access also drops the cached ELF headers of the inode, as
+ * the writer may change them.
  */
+#ifdef CONFIG_BINFMT_ELF_CACHE
+void __elf_layout_invalidate(struct inode *inode);
+
+static inline void elf_layout_invalidate(struct inode *inode)
+{
+	if (unlikely(READ_ONCE(inode->i_elf_layout)))
+		__elf_layout_invalidate(inode);
+}
+#else
+static inline void elf_layout_invalidate(struct inode *inode)
+{
+}
+#endif
+
 static inline int get_write_access(struct inode *inode)
 {
-	return atomic_inc_unless_negative(&inode->i_writecount) ? 0 : -ETXTBSY;
+	if (!atomic_inc_unless_negative(&inode->i_writecount))
+		return -ETXTBSY;
+	elf_layout_invalidate(inode);
+	return 0;
 }
 static inline int deny_write_access(struct file *file)
 {
@@ -39,6 +39,7 @@ struct pipe_buffer {
  *	@head: The point of buffer production
  *	@tail: The point of buffer consumption
  *	@note_loss: The next read() should insert a data-lost message
+ *	@auto_grow: The ring may grow for a streaming writer, see pipe_auto_grow()
  *	@max_usage: The maximum number of slots that may be used in the ring
  *	@ring_size: total number of buffers (should be a power of 2)
  *	@nr_accounted: The amount this pipe accounts for in user->pipe_bufs
@@ -64,6 +65,7 @@ struct pipe_inode_info {
 #ifdef CONFIG_WATCH_QUEUE
 	bool note_loss;
 #endif
+	bool auto_grow;
 	unsigned int nr_accounted;
 	unsigned int readers;
 	unsigned int writers;
@@ -237,6 +239,7 @@ void pipe_unlock(struct pipe_inode_info *);
 void pipe_double_lock(struct pipe_inode_info *, struct pipe_inode_info *);
 
 extern unsigned int pipe_max_size;
+extern unsigned int pipe_auto_max_size;
 extern unsigned long pipe_user_pages_hard;
 extern unsigned long pipe_user_pages_soft;
 
@@ -34,6 +34,16 @@ struct kernel_clone_args {
 	int io_thread;
 	struct cgroup *cgrp;
 	struct css_set *cset;
+	/* Queued on the child before it first runs */
+	struct callback_head *task_work;
+	/*
+	 * For spawn(): the child's pid is returned in @child_pid, and a
+	 * CLONE_PIDFD pidfd is reserved but left to the caller to install.
+	 */
+	int spawn;
+	struct pid *child_pid;
+	struct file *pidfile;
+	int pidfd_nr;
 };
 
 /*
@@ -89,6 +99,7 @@ struct mm_struct *copy_init_mm(void);
 extern pid_t kernel_thread(int (*fn)(void *), void *arg, unsigned long flags);
 extern long kernel_wait4(pid_t, int __user *, int, struct rusage *);
 int kernel_wait(pid_t pid, int *stat);
+int kernel_wait_pid(struct pid *pid, int options, int *stat);
 
 extern void free_task(struct task_struct *tsk);
 
@@ -54,7 +54,8 @@ struct svc_xprt {
 	const struct svc_xprt_ops *xpt_ops;
 	struct kref		xpt_ref;
 	struct list_head	xpt_list;
-	struct list_head	xpt_ready;
+	struct llist_node	xpt_queued;	/* on svc_pool::sp_xprts */
+	struct list_head	xpt_ready;	/* on svc_pool::sp_sockets */
 	unsigned long		xpt_flags;
 #define	XPT_BUSY	0		/* enqueued/receiving */
 #define	XPT_CONN	1		/* conn pending */
@@ -47,6 +47,7 @@ struct stat64;
 struct statfs;
 struct statfs64;
 struct statx;
+struct statx_batch_entry;
 struct sysinfo;
 struct timespec;
 struct __kernel_old_timeval;
@@ -67,6 +68,7 @@ struct rseq;
 union bpf_attr;
 struct io_uring_params;
 struct clone_args;
+struct spawn_args;
 struct open_how;
 struct mount_attr;
 
@@ -888,6 +890,8 @@ asmlinkage long sys_clone(unsigned long, unsigned long, int __user *,
 #endif
 
 asmlinkage long sys_clone3(struct clone_args __user *uargs, size_t size);
+asmlinkage long sys_spawn(struct clone_args __user *uargs, size_t size,
+			  struct spawn_args __user *sargs, size_t ssize);
 
 asmlinkage long sys_execve(const char __user *filename,
 		const char __user *const __user *argv,
@@ -1023,6 +1027,10 @@ asmlinkage long sys_pkey_alloc(unsigned long flags, unsigned long init_val);
 asmlinkage long sys_pkey_free(int pkey);
 asmlinkage long sys_statx(int dfd, const char __user *path, unsigned flags,
 			  unsigned mask, struct statx __user *buffer);
+asmlinkage long sys_statx_batch(int dfd,
+				struct statx_batch_entry __user *entries,
+				unsigned int nr, unsigned int flags,
+				unsigned int mask);
 asmlinkage long sys_rseq(struct rseq __user *rseq, uint32_t rseq_len,
 			 int flags, uint32_t sig);
 asmlinkage long sys_open_tree(int dfd, const char __user *path, unsigned flags);
@@ -1272,6 +1280,8 @@ asmlinkage long sys_ni_syscall(void);
  */
 ssize_t ksys_write(unsigned int fd, const char __user *buf, size_t count);
 int ksys_fchown(unsigned int fd, uid_t user, gid_t group);
+int ksys_fchdir(unsigned int fd);
+int ksys_dup3(unsigned int oldfd, unsigned int newfd, int flags);
 ssize_t ksys_read(unsigned int fd, char __user *buf, size_t count);
 void ksys_sync(void);
 int ksys_unshare(unsigned long unshare_flags);
@@ -1033,7 +1033,7 @@ TRACE_EVENT(ext4_mballoc_alloc,
 		__field(	__u16,	found			)
 		__field(	__u16,	groups			)
 		__field(	__u16,	buddy			)
-		__field(	__u16,	flags			)
+		__field(	__u32,	flags			)
 		__field(	__u16,	tail			)
 		__field(	__u8,	cr			)
 	),
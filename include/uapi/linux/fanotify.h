@@ -161,6 +161,30 @@ struct fanotify_response {
 /* No fd set in event */
 #define FAN_NOFD	-1
 
+/*
+ * A classic BPF program attached with FAN_IOC_SET_FILTER is run on every
+ * event before it is queued, with struct fanotify_filter_data as its
+ * input.  The event is queued if the program returns non-zero and dropped
+ * otherwise.  A filter of length 0 detaches the current one.
+ */
+struct fanotify_filter {
+	__u32	len;		/* number of struct sock_filter instructions */
+	__u32	pad;
+	__u64	filter;		/* struct sock_filter * */
+};
+
+struct fanotify_filter_data {
+	__u32	mask;		/* FAN_* event bits */
+	__u32	mode;		/* st_mode of the object, 0 if none */
+	__u64	ino;		/* st_ino of the object, 0 if none */
+	__u32	dev;		/* st_dev of the object, 0 if none */
+	__s32	pid;		/* tgid of the process causing the event */
+	__u32	uid;		/* its euid */
+	__u32	pad;
+};
+
+#define FAN_IOC_SET_FILTER	_IOW(0xfa, 1, struct fanotify_filter)
+
 /* Helper functions to deal with fanotify_event_metadata buffers */
 #define FAN_EVENT_METADATA_LEN (sizeof(struct fanotify_event_metadata))
 
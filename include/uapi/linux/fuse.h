@@ -179,6 +179,11 @@
  *  7.33
  *  - add FUSE_HANDLE_KILLPRIV_V2, FUSE_WRITE_KILL_SUIDGID, FATTR_KILL_SUIDGID
  *  - add FUSE_OPEN_KILL_SUIDGID
+ *
+ *  7.34
+ *  - add FUSE_PASSTHROUGH, FUSE_DEV_IOC_PASSTHROUGH_OPEN and
+ *    passthrough_fh to fuse_open_out
+ *  - add FUSE_DEV_IOC_BIND_CPU
  */
 
 #ifndef _LINUX_FUSE_H
@@ -214,7 +219,7 @@
 #define FUSE_KERNEL_VERSION 7
 
 /** Minor version number of this interface */
-#define FUSE_KERNEL_MINOR_VERSION 33
+#define FUSE_KERNEL_MINOR_VERSION 34
 
 /** The node ID of the root inode */
 #define FUSE_ROOT_ID 1
@@ -330,6 +335,10 @@ struct fuse_file_lock {
  *			does not have CAP_FSETID. Additionally upon
  *			write/truncate sgid is killed only if file has group
  *			execute permission. (Same as Linux VFS behavior).
+ * FUSE_PASSTHROUGH: read/write/mmap of files opened with a passthrough_fh
+ *		     are served directly from the backing file registered with
+ *		     FUSE_DEV_IOC_PASSTHROUGH_OPEN, which requires
+ *		     CAP_SYS_ADMIN
  */
 #define FUSE_ASYNC_READ		(1 << 0)
 #define FUSE_POSIX_LOCKS	(1 << 1)
@@ -360,6 +369,7 @@ struct fuse_file_lock {
 #define FUSE_MAP_ALIGNMENT	(1 << 26)
 #define FUSE_SUBMOUNTS		(1 << 27)
 #define FUSE_HANDLE_KILLPRIV_V2	(1 << 28)
+#define FUSE_PASSTHROUGH	(1 << 31)
 
 /**
  * CUSE INIT request/reply flags
@@ -625,7 +635,7 @@ struct fuse_create_in {
 struct fuse_open_out {
 	uint64_t	fh;
 	uint32_t	open_flags;
-	uint32_t	padding;
+	uint32_t	passthrough_fh;
 };
 
 struct fuse_release_in {
@@ -905,6 +915,24 @@ struct fuse_notify_retrieve_in {
 /* Device ioctls: */
 #define FUSE_DEV_IOC_MAGIC		229
 #define FUSE_DEV_IOC_CLONE		_IOR(FUSE_DEV_IOC_MAGIC, 0, uint32_t)
+#define FUSE_DEV_IOC_PASSTHROUGH_OPEN	_IOW(FUSE_DEV_IOC_MAGIC, 1, \
+					     struct fuse_passthrough_out)
+
+/*
+ * Argument of FUSE_DEV_IOC_PASSTHROUGH_OPEN: @fd is the backing file opened by
+ * the daemon, @flags must be zero.  The ioctl returns a positive identifier
+ * to be sent back in fuse_open_out.passthrough_fh.
+ */
+struct fuse_passthrough_out {
+	uint32_t	fd;
+	uint32_t	flags;
+};
+
+/*
+ * Bind a (cloned) device to the request queue of the given CPU: requests
+ * submitted on that CPU are only read through the devices bound to it.
+ */
+#define FUSE_DEV_IOC_BIND_CPU		_IOW(FUSE_DEV_IOC_MAGIC, 2, uint32_t)
 
 struct fuse_lseek_in {
 	uint64_t	fh;
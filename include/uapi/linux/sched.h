@@ -102,12 +102,80 @@ struct clone_args {
 	__aligned_u64 set_tid_size;
 	__aligned_u64 cgroup;
 };
+
+/**
+ * struct spawn_args - what the spawn syscall runs in the new process
+ * @pathname:   The binary to run, looked up as for execveat().
+ * @argv:       The argument vector, as for execveat().
+ * @envp:       The environment, as for execveat().
+ * @actions:    Pointer to an array of struct spawn_action, which
+ *              are applied in order before the exec.
+ * @rlimits:    Pointer to an array of struct spawn_rlimit, which
+ *              are applied after @actions.
+ * @nr_actions: Number of entries in @actions.
+ * @nr_rlimits: Number of entries in @rlimits.
+ * @dirfd:      The directory @pathname is relative to, as for
+ *              execveat().
+ * @flags:      AT_EMPTY_PATH and AT_SYMLINK_NOFOLLOW, as for
+ *              execveat().
+ *
+ * The structure is versioned by size like struct clone_args.
+ */
+struct spawn_args {
+	__aligned_u64 pathname;
+	__aligned_u64 argv;
+	__aligned_u64 envp;
+	__aligned_u64 actions;
+	__aligned_u64 rlimits;
+	__u32 nr_actions;
+	__u32 nr_rlimits;
+	__s32 dirfd;
+	__u32 flags;
+};
+
+/**
+ * struct spawn_action - one file action for the spawn syscall
+ * @type:  SPAWN_ACTION_DUP2: dup2(@fd, @newfd).  If @fd and @newfd
+ *         are the same, close-on-exec is cleared on @fd.
+ *         SPAWN_ACTION_CLOSE_RANGE: close_range(@fd, @newfd, @flags).
+ *         SPAWN_ACTION_FCHDIR: fchdir(@fd).
+ * @fd:    The file descriptor acted on.
+ * @newfd: The target descriptor, or the last one of the range.
+ * @flags: CLOSE_RANGE_* flags for SPAWN_ACTION_CLOSE_RANGE, else 0.
+ */
+struct spawn_action {
+	__u32 type;
+	__u32 fd;
+	__u32 newfd;
+	__u32 flags;
+};
+
+/**
+ * struct spawn_rlimit - one resource limit for the spawn syscall
+ * @resource:   The RLIMIT_* to set.
+ * @__reserved: Must be 0.
+ * @rlim_cur:   The soft limit, as for prlimit64().
+ * @rlim_max:   The hard limit, as for prlimit64().
+ */
+struct spawn_rlimit {
+	__u32 resource;
+	__u32 __reserved;
+	__aligned_u64 rlim_cur;
+	__aligned_u64 rlim_max;
+};
 #endif
 
 #define CLONE_ARGS_SIZE_VER0 64 /* sizeof first published struct */
 #define CLONE_ARGS_SIZE_VER1 80 /* sizeof second published struct */
 #define CLONE_ARGS_SIZE_VER2 88 /* sizeof third published struct */
 
+#define SPAWN_ARGS_SIZE_VER0 56 /* sizeof first published struct */
+
+/* struct spawn_action types */
+#define SPAWN_ACTION_DUP2		1
+#define SPAWN_ACTION_CLOSE_RANGE	2
+#define SPAWN_ACTION_FCHDIR		3
+
 /*
  * Scheduling policies
  */
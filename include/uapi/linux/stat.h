@@ -130,6 +130,18 @@ struct statx {
 	/* 0x100 */
 };
 
+/*
+ * One name for statx_batch().  @pathname is looked up relative to the
+ * directory fd passed to the call, the result is written to @buffer and
+ * 0 or a negative error code is stored in @result.
+ */
+struct statx_batch_entry {
+	__u64	pathname;	/* const char * */
+	__u64	buffer;		/* struct statx * */
+	__s32	result;
+	__u32	__spare;
+};
+
 /*
  * Flags to be stx_mask
  *
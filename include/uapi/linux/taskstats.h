@@ -183,7 +183,8 @@ struct taskstats {
 
 enum {
 	TASKSTATS_CMD_UNSPEC = 0,	/* Reserved */
-	TASKSTATS_CMD_GET,		/* user->kernel request/get-response */
+	TASKSTATS_CMD_GET,		/* user->kernel request/get-response,
+					 * as a dump: stats of all tasks */
 	TASKSTATS_CMD_NEW,		/* kernel->user event */
 	__TASKSTATS_CMD_MAX,
 };
@@ -209,6 +210,7 @@ enum {
 	TASKSTATS_CMD_ATTR_TGID,
 	TASKSTATS_CMD_ATTR_REGISTER_CPUMASK,
 	TASKSTATS_CMD_ATTR_DEREGISTER_CPUMASK,
+	TASKSTATS_CMD_ATTR_CGROUP_FD,	/* dump: only tasks in this cgroup2 */
 	__TASKSTATS_CMD_ATTR_MAX,
 };
 
@@ -1636,18 +1636,32 @@ long kernel_wait4(pid_t upid, int __user *stat_addr, int options,
 }
 
 int kernel_wait(pid_t pid, int *stat)
+{
+	struct pid *wo_pid = find_get_pid(pid);
+	int ret;
+
+	ret = kernel_wait_pid(wo_pid, 0, stat);
+	put_pid(wo_pid);
+	return ret;
+}
+
+/*
+ * Like kernel_wait(), for a child the caller holds the struct pid of, so
+ * that it can't be confused with a new task reusing the number.  @options
+ * are added to WEXITED, e.g. __WALL to reap children with any exit signal.
+ */
+int kernel_wait_pid(struct pid *pid, int options, int *stat)
 {
 	struct wait_opts wo = {
 		.wo_type	= PIDTYPE_PID,
-		.wo_pid		= find_get_pid(pid),
-		.wo_flags	= WEXITED,
+		.wo_pid		= pid,
+		.wo_flags	= WEXITED | options,
 	};
 	int ret;
 
 	ret = do_wait(&wo);
 	if (ret > 0 && wo.wo_stat)
 		*stat = wo.wo_stat;
-	put_pid(wo.wo_pid);
 	return ret;
 }
 
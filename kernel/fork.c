@@ -41,6 +41,7 @@
 #include <linux/mman.h>
 #include <linux/mmu_notifier.h>
 #include <linux/fs.h>
+#include <linux/namei.h>
 #include <linux/mm.h>
 #include <linux/vmacache.h>
 #include <linux/nsproxy.h>
@@ -96,6 +97,8 @@
 #include <linux/kasan.h>
 #include <linux/scs.h>
 #include <linux/io_uring.h>
+#include <linux/task_work.h>
+#include <linux/resource.h>
 
 #include <asm/pgalloc.h>
 #include <linux/uaccess.h>
@@ -2270,8 +2273,14 @@ static __latent_entropy struct task_struct *copy_process(
 	}
 
 	/* past the last point of failure */
-	if (pidfile)
-		fd_install(pidfd, pidfile);
+	if (pidfile) {
+		if (args->spawn) {
+			args->pidfile = pidfile;
+			args->pidfd_nr = pidfd;
+		} else {
+			fd_install(pidfd, pidfile);
+		}
+	}
 
 	init_task_pid_links(p);
 	if (likely(p->pid)) {
@@ -2511,6 +2520,8 @@ pid_t kernel_clone(struct kernel_clone_args *args)
 
 	pid = get_task_pid(p, PIDTYPE_PID);
 	nr = pid_vnr(pid);
+	if (args->spawn)
+		args->child_pid = get_pid(pid);
 
 	if (clone_flags & CLONE_PARENT_SETTID)
 		put_user(nr, args->parent_tid);
@@ -2521,6 +2532,13 @@ pid_t kernel_clone(struct kernel_clone_args *args)
 		get_task_struct(p);
 	}
 
+	/*
+	 * TWA_SIGNAL makes the child run the work before it looks at any
+	 * signal or returns to user space.
+	 */
+	if (args->task_work)
+		task_work_add(p, args->task_work, TWA_SIGNAL);
+
 	wake_up_new_task(p);
 
 	/* forking complete and child started to run, tell ptracer */
@@ -2774,6 +2792,317 @@ SYSCALL_DEFINE2(clone3, struct clone_args __user *, uargs, size_t, size)
 
 	return kernel_clone(&kargs);
 }
+
+/* Upper bound on struct spawn_args::nr_actions */
+#define SPAWN_ACTIONS_MAX	1024
+
+/*
+ * State shared by the caller of spawn() and the new task.  The caller may
+ * be killed while it waits for the exec, so it is refcounted.
+ */
+struct spawn_request {
+	struct callback_head work;
+	refcount_t count;
+	int error;
+	bool compat;
+	int dirfd;
+	int flags;
+	struct filename *filename;
+	const void __user *argv;
+	const void __user *envp;
+	struct spawn_action *actions;
+	unsigned int nr_actions;
+	struct spawn_rlimit *rlimits;
+	unsigned int nr_rlimits;
+};
+
+static void spawn_request_put(struct spawn_request *req)
+{
+	if (!refcount_dec_and_test(&req->count))
+		return;
+
+	if (req->filename)
+		putname(req->filename);
+	kfree(req->actions);
+	kfree(req->rlimits);
+	kfree(req);
+}
+
+static int spawn_do_action(const struct spawn_action *act)
+{
+	int ret;
+
+	switch (act->type) {
+	case SPAWN_ACTION_DUP2:
+		if (act->fd != act->newfd) {
+			ret = ksys_dup3(act->fd, act->newfd, 0);
+			return ret < 0 ? ret : 0;
+		}
+		/* Like posix_spawn(), a dup2 onto itself keeps @fd open */
+		rcu_read_lock();
+		ret = files_lookup_fd_rcu(current->files, act->fd) ? 0 : -EBADF;
+		rcu_read_unlock();
+		if (!ret)
+			set_close_on_exec(act->fd, 0);
+		return ret;
+	case SPAWN_ACTION_CLOSE_RANGE:
+		return __close_range(act->fd, act->newfd, act->flags);
+	case SPAWN_ACTION_FCHDIR:
+		return ksys_fchdir(act->fd);
+	}
+	return -EINVAL;
+}
+
+static int spawn_set_rlimit(const struct spawn_rlimit *r)
+{
+	struct rlimit rlim = {
+		.rlim_cur = min_t(u64, r->rlim_cur, RLIM_INFINITY),
+		.rlim_max = min_t(u64, r->rlim_max, RLIM_INFINITY),
+	};
+
+	return do_prlimit(current, r->resource, &rlim, NULL);
+}
+
+/*
+ * A child whose spawn() failed is reaped by the caller, who never gets to
+ * see its pid.  Don't send the caller its exit signal either.
+ */
+static void spawn_clear_exit_signal(void)
+{
+	write_lock_irq(&tasklist_lock);
+	current->exit_signal = 0;
+	write_unlock_irq(&tasklist_lock);
+}
+
+/*
+ * Runs in the new task before it ever reaches user space.  It shares the
+ * caller's mm, which the caller cannot touch until we exec or exit.
+ */
+static void spawn_exec_work(struct callback_head *work)
+{
+	struct spawn_request *req = container_of(work, struct spawn_request,
+						 work);
+	struct filename *filename = req->filename;
+	unsigned int i;
+	int err = 0;
+
+	/*
+	 * Only run from exit_task_work() if the child died before running.
+	 * That is after exit_mm() released the caller, so req->error was
+	 * left at -EINTR for it, see spawn_request_alloc().
+	 */
+	if (unlikely(current->flags & PF_EXITING)) {
+		spawn_clear_exit_signal();
+		spawn_request_put(req);
+		return;
+	}
+	req->error = 0;
+
+	for (i = 0; !err && i < req->nr_actions; i++)
+		err = spawn_do_action(&req->actions[i]);
+	for (i = 0; !err && i < req->nr_rlimits; i++)
+		err = spawn_set_rlimit(&req->rlimits[i]);
+	if (!err) {
+		req->filename = NULL;
+		err = spawn_execveat(req->dirfd, filename, req->argv,
+				     req->envp, req->flags, req->compat);
+	}
+
+	/*
+	 * A failure past the point of no return is reported by the fatal
+	 * signal exec sends us, the caller has already been released.
+	 */
+	if (err && READ_ONCE(current->vfork_done)) {
+		req->error = err;
+		spawn_clear_exit_signal();
+	}
+	spawn_request_put(req);
+
+	if (err)
+		do_exit(127 << 8);
+}
+
+static struct spawn_request *spawn_request_alloc(struct spawn_args __user *uargs,
+						 size_t usize)
+{
+	struct spawn_request *req;
+	struct spawn_args args;
+	unsigned int i;
+	int err;
+
+	BUILD_BUG_ON(sizeof(struct spawn_args) != SPAWN_ARGS_SIZE_VER0);
+
+	if (unlikely(usize > PAGE_SIZE))
+		return ERR_PTR(-E2BIG);
+	if (unlikely(usize < SPAWN_ARGS_SIZE_VER0))
+		return ERR_PTR(-EINVAL);
+
+	err = copy_struct_from_user(&args, sizeof(args), uargs, usize);
+	if (err)
+		return ERR_PTR(err);
+
+	if (args.flags & ~(AT_EMPTY_PATH | AT_SYMLINK_NOFOLLOW))
+		return ERR_PTR(-EINVAL);
+	if (args.nr_actions > SPAWN_ACTIONS_MAX ||
+	    args.nr_rlimits > RLIM_NLIMITS)
+		return ERR_PTR(-E2BIG);
+
+	req = kzalloc(sizeof(*req), GFP_KERNEL);
+	if (!req)
+		return ERR_PTR(-ENOMEM);
+	refcount_set(&req->count, 1);
+
+	req->filename = getname_flags(u64_to_user_ptr(args.pathname),
+				      (args.flags & AT_EMPTY_PATH) ?
+				      LOOKUP_EMPTY : 0, NULL);
+	if (IS_ERR(req->filename)) {
+		err = PTR_ERR(req->filename);
+		req->filename = NULL;
+		goto out_put;
+	}
+
+	if (args.nr_actions) {
+		req->actions = memdup_user(u64_to_user_ptr(args.actions),
+					   array_size(args.nr_actions,
+						      sizeof(*req->actions)));
+		if (IS_ERR(req->actions)) {
+			err = PTR_ERR(req->actions);
+			req->actions = NULL;
+			goto out_put;
+		}
+		req->nr_actions = args.nr_actions;
+	}
+
+	err = -EINVAL;
+	for (i = 0; i < req->nr_actions; i++) {
+		const struct spawn_action *act = &req->actions[i];
+
+		if (act->type != SPAWN_ACTION_CLOSE_RANGE && act->flags)
+			goto out_put;
+		if (act->type == SPAWN_ACTION_FCHDIR && act->newfd)
+			goto out_put;
+		if (act->type < SPAWN_ACTION_DUP2 ||
+		    act->type > SPAWN_ACTION_FCHDIR)
+			goto out_put;
+	}
+
+	if (args.nr_rlimits) {
+		req->rlimits = memdup_user(u64_to_user_ptr(args.rlimits),
+					   array_size(args.nr_rlimits,
+						      sizeof(*req->rlimits)));
+		if (IS_ERR(req->rlimits)) {
+			err = PTR_ERR(req->rlimits);
+			req->rlimits = NULL;
+			goto out_put;
+		}
+		req->nr_rlimits = args.nr_rlimits;
+	}
+
+	err = -EINVAL;
+	for (i = 0; i < req->nr_rlimits; i++) {
+		if (req->rlimits[i].resource >= RLIM_NLIMITS ||
+		    req->rlimits[i].__reserved)
+			goto out_put;
+	}
+
+	req->compat = in_compat_syscall();
+	req->dirfd = args.dirfd;
+	req->flags = args.flags;
+	req->argv = u64_to_user_ptr(args.argv);
+	req->envp = u64_to_user_ptr(args.envp);
+	init_task_work(&req->work, spawn_exec_work);
+	/* Until the child gets to run spawn_exec_work() */
+	req->error = -EINTR;
+
+	/* One for us, one for the child's task work */
+	refcount_set(&req->count, 2);
+	return req;
+
+out_put:
+	spawn_request_put(req);
+	return ERR_PTR(err);
+}
+
+static bool spawn_clone_args_valid(struct kernel_clone_args *kargs)
+{
+	/* The child runs nothing of ours, so it gets no stack, tls or tids */
+	if (kargs->flags &
+	    ~(CLONE_PIDFD | CLONE_PARENT_SETTID | CLONE_INTO_CGROUP))
+		return false;
+
+	if (kargs->stack || kargs->stack_size || kargs->tls ||
+	    kargs->set_tid_size)
+		return false;
+
+	return true;
+}
+
+/**
+ * spawn - create a new process running a new program
+ * @uargs: clone3() arguments for the new process
+ * @size:  size of @uargs
+ * @sargs: the program to run and how to set up for it
+ * @ssize: size of @sargs
+ *
+ * spawn() does what a vfork() child calling execveat() would, without
+ * ever returning to user space in the child.  The child shares our mm
+ * until the exec, applies the file actions and resource limits in
+ * @sargs, and execs.  @uargs may ask for a pidfd, the parent tid and a
+ * cgroup to start in; other clone flags are rejected.
+ *
+ * Return: On success, a positive PID for the child process.  If the
+ *         child could not be set up or the exec failed, the child is
+ *         reaped without sending its exit signal, and a negative errno
+ *         number is returned.
+ */
+SYSCALL_DEFINE4(spawn, struct clone_args __user *, uargs, size_t, size,
+		struct spawn_args __user *, sargs, size_t, ssize)
+{
+	struct kernel_clone_args kargs;
+	pid_t set_tid[MAX_PID_NS_LEVEL];
+	struct spawn_request *req;
+	pid_t nr;
+	int err;
+
+	kargs.set_tid = set_tid;
+
+	err = copy_clone_args_from_user(&kargs, uargs, size);
+	if (err)
+		return err;
+
+	if (!spawn_clone_args_valid(&kargs))
+		return -EINVAL;
+
+	req = spawn_request_alloc(sargs, ssize);
+	if (IS_ERR(req))
+		return PTR_ERR(req);
+
+	kargs.flags |= CLONE_VM | CLONE_VFORK | CLONE_UNTRACED;
+	kargs.task_work = &req->work;
+	kargs.spawn = 1;
+
+	nr = kernel_clone(&kargs);
+	if (nr < 0) {
+		/* No child, so the task work will never drop its reference */
+		spawn_request_put(req);
+	} else if (req->error) {
+		int status;
+
+		/* The pidfd was never installed, nobody else can have it */
+		if (kargs.pidfile) {
+			fput(kargs.pidfile);
+			put_unused_fd(kargs.pidfd_nr);
+		}
+		kernel_wait_pid(kargs.child_pid, __WALL, &status);
+		nr = req->error;
+	} else if (kargs.pidfile) {
+		fd_install(kargs.pidfd_nr, kargs.pidfile);
+	}
+
+	put_pid(kargs.child_pid);
+	spawn_request_put(req);
+	return nr;
+}
 #endif
 
 void walk_process_tree(struct task_struct *top, proc_visitor visitor, void *data)
@@ -141,6 +141,7 @@ COND_SYSCALL(capset);
 /* kernel/fork.c */
 /* __ARCH_WANT_SYS_CLONE3 */
 COND_SYSCALL(clone3);
+COND_SYSCALL(spawn);
 
 /* kernel/futex.c */
 COND_SYSCALL(futex);
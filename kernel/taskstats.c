@@ -38,7 +38,8 @@ static const struct nla_policy taskstats_cmd_get_policy[] = {
 	[TASKSTATS_CMD_ATTR_PID]  = { .type = NLA_U32 },
 	[TASKSTATS_CMD_ATTR_TGID] = { .type = NLA_U32 },
 	[TASKSTATS_CMD_ATTR_REGISTER_CPUMASK] = { .type = NLA_STRING },
-	[TASKSTATS_CMD_ATTR_DEREGISTER_CPUMASK] = { .type = NLA_STRING },};
+	[TASKSTATS_CMD_ATTR_DEREGISTER_CPUMASK] = { .type = NLA_STRING },
+	[TASKSTATS_CMD_ATTR_CGROUP_FD] = { .type = NLA_U32 },};
 
 static const struct nla_policy cgroupstats_cmd_get_policy[] = {
 	[CGROUPSTATS_CMD_ATTR_FD] = { .type = NLA_U32 },
@@ -547,6 +548,112 @@ static int taskstats_user_cmd(struct sk_buff *skb, struct genl_info *info)
 		return -EINVAL;
 }
 
+#ifdef CONFIG_CGROUPS
+static struct cgroup *taskstats_dump_cgroup(struct nlattr *na)
+{
+	return na ? cgroup_get_from_fd(nla_get_u32(na)) : NULL;
+}
+
+static bool taskstats_dump_match(struct task_struct *tsk, struct cgroup *cgrp)
+{
+	return !cgrp || cgroup_is_descendant(task_dfl_cgroup(tsk), cgrp);
+}
+
+static void taskstats_dump_put_cgroup(struct cgroup *cgrp)
+{
+	if (cgrp)
+		cgroup_put(cgrp);
+}
+#else
+static struct cgroup *taskstats_dump_cgroup(struct nlattr *na)
+{
+	return na ? ERR_PTR(-EOPNOTSUPP) : NULL;
+}
+
+static bool taskstats_dump_match(struct task_struct *tsk, struct cgroup *cgrp)
+{
+	return true;
+}
+
+static void taskstats_dump_put_cgroup(struct cgroup *cgrp)
+{
+}
+#endif
+
+static int taskstats_dump_one(struct sk_buff *skb, struct netlink_callback *cb,
+			      struct task_struct *tsk, pid_t pid,
+			      struct pid_namespace *pid_ns)
+{
+	struct taskstats *stats;
+	void *hdr;
+
+	hdr = genlmsg_put(skb, NETLINK_CB(cb->skb).portid, cb->nlh->nlmsg_seq,
+			  &family, NLM_F_MULTI, TASKSTATS_CMD_NEW);
+	if (!hdr)
+		return -EMSGSIZE;
+
+	stats = mk_reply(skb, TASKSTATS_TYPE_PID, pid);
+	if (!stats) {
+		genlmsg_cancel(skb, hdr);
+		return -EMSGSIZE;
+	}
+	fill_stats(current_user_ns(), pid_ns, tsk, stats);
+	genlmsg_end(skb, hdr);
+	return 0;
+}
+
+/*
+ * Dump the stats of every task in the caller's pid namespace, optionally
+ * only those in a cgroup2 subtree, in one pass over the pid idr.  This saves
+ * monitoring agents a TASKSTATS_CMD_GET round trip, or a handful of /proc
+ * reads, per task.  cb->args[0] is the pid to resume from.
+ */
+static int taskstats_user_dump(struct sk_buff *skb, struct netlink_callback *cb)
+{
+	const struct genl_dumpit_info *info = genl_dumpit_info(cb);
+	struct pid_namespace *pid_ns = task_active_pid_ns(current);
+	pid_t nr = max_t(pid_t, cb->args[0], 1);
+	struct cgroup *cgrp;
+
+	cgrp = taskstats_dump_cgroup(info->attrs[TASKSTATS_CMD_ATTR_CGROUP_FD]);
+	if (IS_ERR(cgrp))
+		return PTR_ERR(cgrp);
+
+	for (;; nr++) {
+		struct task_struct *tsk = NULL;
+		struct pid *pid;
+		int rc;
+
+		rcu_read_lock();
+		pid = find_ge_pid(nr, pid_ns);
+		if (pid) {
+			nr = pid_nr_ns(pid, pid_ns);
+			tsk = pid_task(pid, PIDTYPE_PID);
+			if (tsk && taskstats_dump_match(tsk, cgrp))
+				get_task_struct(tsk);
+			else
+				tsk = NULL;
+		}
+		rcu_read_unlock();
+
+		if (!pid)
+			break;
+		if (!tsk)
+			continue;
+
+		/* fill_stats() may sleep, so it runs outside RCU */
+		rc = taskstats_dump_one(skb, cb, tsk, nr, pid_ns);
+		put_task_struct(tsk);
+		if (rc)
+			break;
+		cond_resched();
+	}
+
+	taskstats_dump_put_cgroup(cgrp);
+	cb->args[0] = nr;
+	return skb->len;
+}
+
 static struct taskstats *taskstats_tgid_alloc(struct task_struct *tsk)
 {
 	struct signal_struct *sig = tsk->signal;
@@ -643,8 +750,10 @@ void taskstats_exit(struct task_struct *tsk, int group_dead)
 static const struct genl_ops taskstats_ops[] = {
 	{
 		.cmd		= TASKSTATS_CMD_GET,
-		.validate = GENL_DONT_VALIDATE_STRICT | GENL_DONT_VALIDATE_DUMP,
+		.validate = GENL_DONT_VALIDATE_STRICT |
+			    GENL_DONT_VALIDATE_DUMP_STRICT,
 		.doit		= taskstats_user_cmd,
+		.dumpit		= taskstats_user_dump,
 		.policy		= taskstats_cmd_get_policy,
 		.maxattr	= ARRAY_SIZE(taskstats_cmd_get_policy) - 1,
 		.flags		= GENL_ADMIN_PERM,
@@ -477,9 +477,12 @@ __svc_create(struct svc_program *prog, unsigned int bufsize, int npools,
 				i, serv->sv_name);
 
 		pool->sp_id = i;
+		init_llist_head(&pool->sp_xprts);
 		INIT_LIST_HEAD(&pool->sp_sockets);
 		INIT_LIST_HEAD(&pool->sp_all_threads);
+		init_llist_head(&pool->sp_idle_threads);
 		spin_lock_init(&pool->sp_lock);
+		spin_lock_init(&pool->sp_idle_lock);
 	}
 
 	return serv;
@@ -609,7 +612,7 @@ svc_rqst_alloc(struct svc_serv *serv, struct svc_pool *pool, int node)
 	if (!rqstp)
 		return rqstp;
 
-	__set_bit(RQ_BUSY, &rqstp->rq_flags);
+	init_llist_node(&rqstp->rq_idle);
 	spin_lock_init(&rqstp->rq_lock);
 	rqstp->rq_server = serv;
 	rqstp->rq_pool = pool;
@@ -46,6 +46,10 @@ static LIST_HEAD(svc_xprt_class_list);
 /* SMP locking strategy:
  *
  *	svc_pool->sp_lock protects most of the fields of that pool.
+ *	Transports are queued on svc_pool->sp_xprts and threads put
+ *	themselves on svc_pool->sp_idle_threads without taking a lock.
+ *	Taking transports off sp_xprts is done under sp_lock, taking
+ *	threads off sp_idle_threads under svc_pool->sp_idle_lock.
  *	svc_serv->sv_lock protects sv_tempsocks, sv_permsocks, sv_tmpcnt.
  *	when both need to be taken (rare), svc_serv->sv_lock is first.
  *	The "service mutex" protects svc_serv->sv_nrthread.
@@ -177,6 +181,7 @@ void svc_xprt_init(struct net *net, struct svc_xprt_class *xcl,
 	kref_init(&xprt->xpt_ref);
 	xprt->xpt_server = serv;
 	INIT_LIST_HEAD(&xprt->xpt_list);
+	init_llist_node(&xprt->xpt_queued);
 	INIT_LIST_HEAD(&xprt->xpt_ready);
 	INIT_LIST_HEAD(&xprt->xpt_deferred);
 	INIT_LIST_HEAD(&xprt->xpt_users);
@@ -405,6 +410,92 @@ static bool svc_xprt_ready(struct svc_xprt *xprt)
 	return false;
 }
 
+/*
+ * Take the thread that went idle last off the pool's idle list and wake
+ * it.  Threads add themselves to the list without a lock, only taking
+ * them off needs sp_idle_lock.
+ *
+ * Must be called under rcu_read_lock().  Once woken, the thread may exit
+ * and free itself at any time, so the returned svc_rqst may only be used
+ * until rcu_read_unlock().
+ */
+static struct svc_rqst *svc_pool_wake_idle_thread(struct svc_pool *pool)
+{
+	struct svc_rqst	*rqstp;
+	struct llist_node *ln;
+
+	if (llist_empty(&pool->sp_idle_threads))
+		return NULL;
+
+	spin_lock_bh(&pool->sp_idle_lock);
+	ln = llist_del_first(&pool->sp_idle_threads);
+	if (ln)
+		init_llist_node(ln);
+	spin_unlock_bh(&pool->sp_idle_lock);
+	if (!ln)
+		return NULL;
+
+	rqstp = llist_entry(ln, struct svc_rqst, rq_idle);
+	atomic_long_inc(&pool->sp_stats.threads_woken);
+	rqstp->rq_qtime = ktime_get();
+	wake_up_process(rqstp->rq_task);
+	return rqstp;
+}
+
+/*
+ * Take @rqstp off the idle list if it woke up by itself, rather than
+ * being taken off by svc_pool_wake_idle_thread().
+ */
+static void svc_rqst_leave_idle(struct svc_rqst *rqstp)
+{
+	struct svc_pool *pool = rqstp->rq_pool;
+	struct llist_node *ln;
+
+	if (!llist_on_list(&rqstp->rq_idle))
+		return;
+
+	spin_lock_bh(&pool->sp_idle_lock);
+	if (llist_on_list(&rqstp->rq_idle)) {
+		/*
+		 * Nodes are only added at the head, and only removed under
+		 * sp_idle_lock, so the chain below the head can't change.
+		 */
+		ln = READ_ONCE(pool->sp_idle_threads.first);
+		if (ln != &rqstp->rq_idle ||
+		    cmpxchg(&pool->sp_idle_threads.first, ln,
+			    ln->next) != ln) {
+			ln = READ_ONCE(pool->sp_idle_threads.first);
+			while (ln->next != &rqstp->rq_idle)
+				ln = ln->next;
+			ln->next = rqstp->rq_idle.next;
+		}
+		init_llist_node(&rqstp->rq_idle);
+	}
+	spin_unlock_bh(&pool->sp_idle_lock);
+}
+
+/*
+ * Move the transports queued since the last call over to sp_sockets,
+ * oldest first.  Called with sp_lock held.
+ */
+static void svc_pool_take_queued(struct svc_pool *pool)
+{
+	struct llist_node *ln = llist_del_all(&pool->sp_xprts);
+	struct svc_xprt *xprt, *next;
+
+	ln = llist_reverse_order(ln);
+	llist_for_each_entry_safe(xprt, next, ln, xpt_queued) {
+		init_llist_node(&xprt->xpt_queued);
+		list_add_tail(&xprt->xpt_ready, &pool->sp_sockets);
+	}
+}
+
+static bool svc_pool_has_xprts(struct svc_pool *pool)
+{
+	return !list_empty(&pool->sp_sockets) ||
+	       !llist_empty(&pool->sp_xprts);
+}
+
 void svc_xprt_do_enqueue(struct svc_xprt *xprt)
 {
 	struct svc_pool *pool;
@@ -427,27 +518,18 @@ void svc_xprt_do_enqueue(struct svc_xprt *xprt)
 
 	atomic_long_inc(&pool->sp_stats.packets);
 
-	spin_lock_bh(&pool->sp_lock);
-	list_add_tail(&xprt->xpt_ready, &pool->sp_sockets);
-	pool->sp_stats.sockets_queued++;
-	spin_unlock_bh(&pool->sp_lock);
+	/* Full barrier, pairs with svc_get_next_xprt() going idle */
+	llist_add(&xprt->xpt_queued, &pool->sp_xprts);
+	atomic_long_inc(&pool->sp_stats.sockets_queued);
 
 	/* find a thread for this xprt */
 	rcu_read_lock();
-	list_for_each_entry_rcu(rqstp, &pool->sp_all_threads, rq_all) {
-		if (test_and_set_bit(RQ_BUSY, &rqstp->rq_flags))
-			continue;
-		atomic_long_inc(&pool->sp_stats.threads_woken);
-		rqstp->rq_qtime = ktime_get();
-		wake_up_process(rqstp->rq_task);
-		goto out_unlock;
-	}
-	set_bit(SP_CONGESTED, &pool->sp_flags);
-	rqstp = NULL;
-out_unlock:
-	rcu_read_unlock();
+	rqstp = svc_pool_wake_idle_thread(pool);
+	if (!rqstp)
+		set_bit(SP_CONGESTED, &pool->sp_flags);
 	put_cpu();
 	trace_svc_xprt_do_enqueue(xprt, rqstp);
+	rcu_read_unlock();
 }
 EXPORT_SYMBOL_GPL(svc_xprt_do_enqueue);
 
@@ -471,10 +553,12 @@ static struct svc_xprt *svc_xprt_dequeue(struct svc_pool *pool)
 {
 	struct svc_xprt	*xprt = NULL;
 
-	if (list_empty(&pool->sp_sockets))
+	if (!svc_pool_has_xprts(pool))
 		goto out;
 
 	spin_lock_bh(&pool->sp_lock);
+	if (list_empty(&pool->sp_sockets))
+		svc_pool_take_queued(pool);
 	if (likely(!list_empty(&pool->sp_sockets))) {
 		xprt = list_first_entry(&pool->sp_sockets,
 					struct svc_xprt, xpt_ready);
@@ -556,13 +640,10 @@ void svc_wake_up(struct svc_serv *serv)
 	pool = &serv->sv_pools[0];
 
 	rcu_read_lock();
-	list_for_each_entry_rcu(rqstp, &pool->sp_all_threads, rq_all) {
-		/* skip any that aren't queued */
-		if (test_bit(RQ_BUSY, &rqstp->rq_flags))
-			continue;
-		rcu_read_unlock();
-		wake_up_process(rqstp->rq_task);
+	rqstp = svc_pool_wake_idle_thread(pool);
+	if (rqstp) {
 		trace_svc_wake_up(rqstp->rq_task->pid);
+		rcu_read_unlock();
 		return;
 	}
 	rcu_read_unlock();
@@ -693,7 +774,7 @@ rqst_should_sleep(struct svc_rqst *rqstp)
 		return false;
 
 	/* was a socket queued? */
-	if (!list_empty(&pool->sp_sockets))
+	if (svc_pool_has_xprts(pool))
 		return false;
 
 	/* are we shutting down? */
@@ -726,8 +807,8 @@ static struct svc_xprt *svc_get_next_xprt(struct svc_rqst *rqstp, long timeout)
 	set_current_state(TASK_INTERRUPTIBLE);
 	smp_mb__before_atomic();
 	clear_bit(SP_CONGESTED, &pool->sp_flags);
-	clear_bit(RQ_BUSY, &rqstp->rq_flags);
-	smp_mb__after_atomic();
+	/* Full barrier, pairs with svc_xprt_do_enqueue() */
+	llist_add(&rqstp->rq_idle, &pool->sp_idle_threads);
 
 	if (likely(rqst_should_sleep(rqstp)))
 		time_left = schedule_timeout(timeout);
@@ -736,8 +817,7 @@ static struct svc_xprt *svc_get_next_xprt(struct svc_rqst *rqstp, long timeout)
 
 	try_to_freeze();
 
-	set_bit(RQ_BUSY, &rqstp->rq_flags);
-	smp_mb__after_atomic();
+	svc_rqst_leave_idle(rqstp);
 	rqstp->rq_xprt = svc_xprt_dequeue(pool);
 	if (rqstp->rq_xprt)
 		goto out_found;
@@ -1027,6 +1107,7 @@ static void svc_delete_xprt(struct svc_xprt *xprt)
 	spin_lock_bh(&serv->sv_lock);
 	list_del_init(&xprt->xpt_list);
 	WARN_ON_ONCE(!list_empty(&xprt->xpt_ready));
+	WARN_ON_ONCE(llist_on_list(&xprt->xpt_queued));
 	if (test_bit(XPT_TEMP, &xprt->xpt_flags))
 		serv->sv_tmpcnt--;
 	spin_unlock_bh(&serv->sv_lock);
@@ -1083,6 +1164,7 @@ static struct svc_xprt *svc_dequeue_net(struct svc_serv *serv, struct net *net)
 		pool = &serv->sv_pools[i];
 
 		spin_lock_bh(&pool->sp_lock);
+		svc_pool_take_queued(pool);
 		list_for_each_entry_safe(xprt, tmp, &pool->sp_sockets, xpt_ready) {
 			if (xprt->xpt_net != net)
 				continue;
@@ -1405,7 +1487,7 @@ static int svc_pool_stats_show(struct seq_file *m, void *p)
 	seq_printf(m, "%u %lu %lu %lu %lu\n",
 		pool->sp_id,
 		(unsigned long)atomic_long_read(&pool->sp_stats.packets),
-		pool->sp_stats.sockets_queued,
+		(unsigned long)atomic_long_read(&pool->sp_stats.sockets_queued),
 		(unsigned long)atomic_long_read(&pool->sp_stats.threads_woken),
 		(unsigned long)atomic_long_read(&pool->sp_stats.threads_timedout));
 
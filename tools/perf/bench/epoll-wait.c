@@ -44,6 +44,10 @@
  * not stress scenarios where multiple tasks are awoken per ready IO; ie:
  * EPOLLEXCLUSIVE semantics.
  *
+ * The --percpu option creates the epoll instances with EPOLL_PERCPU_READY,
+ * so that ready fds are queued on per-CPU lists rather than on the single
+ * ready list, which the combined queue model contends on.
+ *
  * The end result/metric is throughput: number of ops/second where an
  * operation consists of:
  *
@@ -105,6 +109,11 @@ static unsigned int nested = 0;
 static bool et; /* edge-trigger */
 static bool oneshot;
 static bool multiq; /* use an epoll instance per thread */
+static bool percpu; /* use per-CPU ready lists */
+
+#ifndef EPOLL_PERCPU_READY
+#define EPOLL_PERCPU_READY 0x00000001
+#endif
 
 /* amount of fds to monitor, per thread */
 static unsigned int nfds = 64;
@@ -137,6 +146,7 @@ static const struct option options[] = {
 	OPT_UINTEGER( 'N', "nested",  &nested,   "Nesting level epoll hierarchy (default is 0, no nesting)"),
 	OPT_BOOLEAN( 'S', "oneshot",  &oneshot,   "Use EPOLLONESHOT semantics"),
 	OPT_BOOLEAN( 'E', "edge",  &et,   "Use Edge-triggered interface (default is LT)"),
+	OPT_BOOLEAN( 'P', "percpu",  &percpu,   "Use per-CPU ready lists (EPOLL_PERCPU_READY)"),
 
 	OPT_END()
 };
@@ -250,9 +260,9 @@ static void nest_epollfd(struct worker *w)
 		err(EXIT_FAILURE, "calloc");
 
 	for (i = 0; i < nested; i++) {
-		epollfdp[i] = epoll_create(1);
+		epollfdp[i] = epoll_create1(percpu ? EPOLL_PERCPU_READY : 0);
 		if (epollfdp[i] < 0)
-			err(EXIT_FAILURE, "epoll_create");
+			err(EXIT_FAILURE, "epoll_create1");
 	}
 
 	ev.events = EPOLLHUP; /* anything */
@@ -310,9 +320,10 @@ static int do_threads(struct worker *worker, struct perf_cpu_map *cpu)
 		struct worker *w = &worker[i];
 
 		if (multiq) {
-			w->epollfd = epoll_create(1);
+			w->epollfd = epoll_create1(percpu ?
+						   EPOLL_PERCPU_READY : 0);
 			if (w->epollfd < 0)
-				err(EXIT_FAILURE, "epoll_create");
+				err(EXIT_FAILURE, "epoll_create1");
 
 			if (nested)
 				nest_epollfd(w);
@@ -436,9 +447,9 @@ int bench_epoll_wait(int argc, const char **argv)
 
 	/* a single, main epoll instance */
 	if (!multiq) {
-		epollfd = epoll_create(1);
+		epollfd = epoll_create1(percpu ? EPOLL_PERCPU_READY : 0);
 		if (epollfd < 0)
-			err(EXIT_FAILURE, "epoll_create");
+			err(EXIT_FAILURE, "epoll_create1");
 
 		/*
 		 * Deal with nested epolls, if any.
@@ -447,7 +458,8 @@ int bench_epoll_wait(int argc, const char **argv)
 			nest_epollfd(NULL);
 	}
 
-	printinfo("Using %s queue model\n", multiq ? "multi" : "single");
+	printinfo("Using %s queue model%s\n", multiq ? "multi" : "single",
+		  percpu ? " with per-CPU ready lists" : "");
 	printinfo("Nesting level(s): %d\n", nested);
 
 	/* default to the number of CPUs and leave one for the writer pthread */
@@ -40,9 +40,13 @@ static	int			loops = LOOPS_DEFAULT;
 /* Use processes by default: */
 static bool			threaded;
 
+/* Bytes passed each way per loop, an int by default: */
+static unsigned int		msg_size = sizeof(int);
+
 static const struct option options[] = {
 	OPT_INTEGER('l', "loop",	&loops,		"Specify number of loops"),
 	OPT_BOOLEAN('T', "threaded",	&threaded,	"Specify threads/process based task setup"),
+	OPT_UINTEGER('s', "size",	&msg_size,	"Specify message size in bytes"),
 	OPT_END()
 };
 
@@ -51,26 +55,47 @@ static const char * const bench_sched_pipe_usage[] = {
 	NULL
 };
 
+/* A message larger than the pipe arrives in several reads */
+static void read_msg(int fd, char *buf)
+{
+	unsigned int done = 0;
+	ssize_t ret;
+
+	while (done < msg_size) {
+		ret = read(fd, buf + done, msg_size - done);
+		BUG_ON(ret <= 0);
+		done += ret;
+	}
+}
+
+static void write_msg(int fd, char *buf)
+{
+	ssize_t ret;
+
+	ret = write(fd, buf, msg_size);
+	BUG_ON(ret != (ssize_t)msg_size);
+}
+
 static void *worker_thread(void *__tdata)
 {
 	struct thread_data *td = __tdata;
-	int m = 0, i;
-	int ret;
+	char *buf;
+	int i;
+
+	buf = calloc(1, msg_size);
+	BUG_ON(!buf);
 
 	for (i = 0; i < loops; i++) {
 		if (!td->nr) {
-			ret = read(td->pipe_read, &m, sizeof(int));
-			BUG_ON(ret != sizeof(int));
-			ret = write(td->pipe_write, &m, sizeof(int));
-			BUG_ON(ret != sizeof(int));
+			read_msg(td->pipe_read, buf);
+			write_msg(td->pipe_write, buf);
 		} else {
-			ret = write(td->pipe_write, &m, sizeof(int));
-			BUG_ON(ret != sizeof(int));
-			ret = read(td->pipe_read, &m, sizeof(int));
-			BUG_ON(ret != sizeof(int));
+			write_msg(td->pipe_write, buf);
+			read_msg(td->pipe_read, buf);
 		}
 	}
 
+	free(buf);
 	return NULL;
 }
 
@@ -92,6 +117,8 @@ int bench_sched_pipe(int argc, const char **argv)
 	pid_t pid, retpid __maybe_unused;
 
 	argc = parse_options(argc, argv, options, bench_sched_pipe_usage, 0);
+	if (!msg_size)
+		usage_with_options(bench_sched_pipe_usage, options);
 
 	BUG_ON(pipe(pipe_1));
 	BUG_ON(pipe(pipe_2));
@@ -151,6 +178,8 @@ int bench_sched_pipe(int argc, const char **argv)
 	case BENCH_FORMAT_DEFAULT:
 		printf("# Executed %d pipe operations between two %s\n\n",
 			loops, threaded ? "threads" : "processes");
+		if (msg_size != sizeof(int))
+			printf("# Message size: %u bytes\n\n", msg_size);
 
 		result_usec = diff.tv_sec * USEC_PER_SEC;
 		result_usec += diff.tv_usec;
@@ -164,6 +193,10 @@ int bench_sched_pipe(int argc, const char **argv)
 		printf(" %14d ops/sec\n",
 		       (int)((double)loops /
 			     ((double)result_usec / (double)USEC_PER_SEC)));
+		if (msg_size != sizeof(int))
+			printf(" %14lf MB/sec\n",
+			       (double)loops * msg_size * 2 /
+			       (double)result_usec);
 		break;
 
 	case BENCH_FORMAT_SIMPLE:
@@ -0,0 +1,134 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Rewrite an executable between execs and check that every exec runs what
+ * is in the file now, whatever the kernel kept from the previous one.
+ * Then time repeated execs of the same binary.
+ *
+ *	exec_latency [-n iterations]
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../kselftest.h"
+
+#define BIN	"exec_latency.bin"
+
+static char self[4096];
+
+static void copy_file(const char *src, const char *dst, int flags)
+{
+	char buf[65536];
+	ssize_t len;
+	int in, out;
+
+	in = open(src, O_RDONLY);
+	if (in < 0)
+		ksft_exit_fail_msg("open %s: %s\n", src, strerror(errno));
+	out = open(dst, O_WRONLY | O_CREAT | flags, 0755);
+	if (out < 0)
+		ksft_exit_fail_msg("open %s: %s\n", dst, strerror(errno));
+
+	while ((len = read(in, buf, sizeof(buf))) > 0) {
+		if (write(out, buf, len) != len)
+			ksft_exit_fail_msg("write %s: %s\n", dst,
+					   strerror(errno));
+	}
+	if (len < 0)
+		ksft_exit_fail_msg("read %s: %s\n", src, strerror(errno));
+	close(in);
+	close(out);
+}
+
+/* Run @path with @arg, return its exit status or -1 */
+static int run(const char *path, const char *arg)
+{
+	int status;
+	pid_t pid;
+
+	pid = fork();
+	if (pid < 0)
+		ksft_exit_fail_msg("fork: %s\n", strerror(errno));
+	if (!pid) {
+		execl(path, path, arg ? "-x" : NULL, arg, NULL);
+		_exit(127);
+	}
+	if (waitpid(pid, &status, 0) != pid || !WIFEXITED(status))
+		return -1;
+	return WEXITSTATUS(status);
+}
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char **argv)
+{
+	int iterations = 5000;
+	double start;
+	ssize_t len;
+	int i, opt;
+
+	/* When run as the rewritten binary */
+	if (argc == 3 && !strcmp(argv[1], "-x"))
+		return atoi(argv[2]);
+
+	while ((opt = getopt(argc, argv, "n:")) != -1) {
+		switch (opt) {
+		case 'n':
+			iterations = atoi(optarg);
+			break;
+		default:
+			ksft_exit_fail_msg("usage: %s [-n iterations]\n",
+					   argv[0]);
+		}
+	}
+
+	len = readlink("/proc/self/exe", self, sizeof(self) - 1);
+	if (len < 0)
+		ksft_exit_fail_msg("readlink: %s\n", strerror(errno));
+	self[len] = '\0';
+
+	ksft_print_header();
+	ksft_set_plan(4);
+
+	copy_file("/bin/true", BIN, O_TRUNC);
+	ksft_test_result(run("./" BIN, NULL) == 0, "exec /bin/true copy\n");
+
+	/* Different program headers, same inode */
+	copy_file(self, BIN, O_TRUNC);
+	ksft_test_result(run("./" BIN, "7") == 7,
+			 "exec after overwrite\n");
+
+	if (truncate(BIN, 0))
+		ksft_exit_fail_msg("truncate: %s\n", strerror(errno));
+	copy_file("/bin/true", BIN, 0);
+	ksft_test_result(run("./" BIN, NULL) == 0,
+			 "exec after truncate and rewrite\n");
+
+	start = now();
+	for (i = 0; i < iterations; i++) {
+		if (run("./" BIN, NULL))
+			break;
+	}
+	ksft_test_result(i == iterations, "%d execs\n", iterations);
+	if (i)
+		ksft_print_msg("fork + exec + exit + wait: %.1f us\n",
+			       (now() - start) * 1e6 / i);
+
+	unlink(BIN);
+	if (ksft_get_fail_cnt())
+		ksft_exit_fail();
+	ksft_exit_pass();
+}
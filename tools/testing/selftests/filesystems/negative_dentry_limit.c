@@ -0,0 +1,138 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Look up many names that don't exist in a fresh directory with
+ * fs.negative-dentry-limit set, and check that the number of negative
+ * dentries in fs.dentry-state stays around the limit instead of growing
+ * with every name probed.
+ *
+ * Must be run as root, from a directory on a filesystem that keeps
+ * negative dentries (not tmpfs).
+ *
+ *	negative_dentry_limit [-n names] [-l limit]
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../kselftest.h"
+
+#define LIMIT_PATH	"/proc/sys/fs/negative-dentry-limit"
+#define STATE_PATH	"/proc/sys/fs/dentry-state"
+#define DIR_NAME	"negative_dentry_limit.dir"
+
+static unsigned long read_ulong(const char *path, int field)
+{
+	unsigned long val[6] = { 0 };
+	FILE *f;
+	int n;
+
+	f = fopen(path, "r");
+	if (!f)
+		ksft_exit_fail_msg("open %s: %s\n", path, strerror(errno));
+	n = fscanf(f, "%lu %lu %lu %lu %lu %lu", &val[0], &val[1], &val[2],
+		   &val[3], &val[4], &val[5]);
+	fclose(f);
+	if (n <= field)
+		ksft_exit_fail_msg("can't parse %s\n", path);
+	return val[field];
+}
+
+static void write_ulong(const char *path, unsigned long val)
+{
+	FILE *f;
+
+	f = fopen(path, "w");
+	if (!f)
+		ksft_exit_fail_msg("open %s: %s\n", path, strerror(errno));
+	fprintf(f, "%lu\n", val);
+	if (fclose(f))
+		ksft_exit_fail_msg("write %s: %s\n", path, strerror(errno));
+}
+
+/* The fifth field of dentry-state is the number of negative dentries */
+static unsigned long nr_negative(void)
+{
+	return read_ulong(STATE_PATH, 4);
+}
+
+static void probe(unsigned long names)
+{
+	char path[64];
+	struct stat st;
+	unsigned long i;
+
+	for (i = 0; i < names; i++) {
+		snprintf(path, sizeof(path), DIR_NAME "/%lx", i);
+		if (!stat(path, &st) || errno != ENOENT)
+			ksft_exit_fail_msg("stat %s: %s\n", path,
+					   strerror(errno));
+	}
+}
+
+int main(int argc, char **argv)
+{
+	unsigned long names = 1000000, limit = 10000;
+	unsigned long old_limit, before, after;
+	struct timespec delay = { .tv_nsec = 100000000 };
+	int opt, i;
+
+	while ((opt = getopt(argc, argv, "n:l:")) != -1) {
+		switch (opt) {
+		case 'n':
+			names = strtoul(optarg, NULL, 0);
+			break;
+		case 'l':
+			limit = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			ksft_exit_fail_msg("usage: %s [-n names] [-l limit]\n",
+					   argv[0]);
+		}
+	}
+	if (!limit || names < 4 * limit)
+		ksft_exit_fail_msg("need a limit and at least 4 * limit names\n");
+
+	ksft_print_header();
+	ksft_set_plan(1);
+
+	if (geteuid())
+		ksft_exit_skip("must be run as root\n");
+	if (access(LIMIT_PATH, W_OK))
+		ksft_exit_skip(LIMIT_PATH " not available\n");
+
+	if (mkdir(DIR_NAME, 0755) && errno != EEXIST)
+		ksft_exit_fail_msg("mkdir: %s\n", strerror(errno));
+
+	old_limit = read_ulong(LIMIT_PATH, 0);
+	write_ulong(LIMIT_PATH, limit);
+
+	before = nr_negative();
+	probe(names);
+
+	/* Pruning is done by a work item, give it some time to run */
+	for (i = 0; i < 50; i++) {
+		after = nr_negative();
+		if (after <= before + limit)
+			break;
+		nanosleep(&delay, NULL);
+	}
+
+	write_ulong(LIMIT_PATH, old_limit);
+	rmdir(DIR_NAME);
+
+	ksft_print_msg("%lu names probed, negative dentries %lu -> %lu\n",
+		       names, before, after);
+	/* Other superblocks and per-cpu counter slack may add a little */
+	ksft_test_result(after <= before + 2 * limit,
+			 "negative dentries kept near the limit of %lu\n",
+			 limit);
+
+	if (ksft_get_fail_cnt())
+		ksft_exit_fail();
+	ksft_exit_pass();
+}
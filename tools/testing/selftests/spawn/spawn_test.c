@@ -0,0 +1,346 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Check that spawn() applies its file actions, working directory and
+ * resource limits before the exec, and that a failed exec is reported
+ * without leaving a child behind.  Then compare the time it takes to
+ * start a program with spawn() and with posix_spawn().
+ *
+ *	spawn_test [-n iterations]
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <signal.h>
+#include <spawn.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/types.h>
+
+#include "../kselftest.h"
+
+#ifndef __NR_spawn
+#define __NR_spawn 444
+#endif
+
+#ifndef CLONE_PIDFD
+#define CLONE_PIDFD 0x00001000
+#endif
+
+#define ptr_to_u64(ptr) ((__u64)((uintptr_t)(ptr)))
+
+struct __clone_args {
+	__aligned_u64 flags;
+	__aligned_u64 pidfd;
+	__aligned_u64 child_tid;
+	__aligned_u64 parent_tid;
+	__aligned_u64 exit_signal;
+	__aligned_u64 stack;
+	__aligned_u64 stack_size;
+	__aligned_u64 tls;
+};
+
+struct __spawn_args {
+	__aligned_u64 pathname;
+	__aligned_u64 argv;
+	__aligned_u64 envp;
+	__aligned_u64 actions;
+	__aligned_u64 rlimits;
+	__u32 nr_actions;
+	__u32 nr_rlimits;
+	__s32 dirfd;
+	__u32 flags;
+};
+
+struct __spawn_action {
+	__u32 type;
+	__u32 fd;
+	__u32 newfd;
+	__u32 flags;
+};
+
+struct __spawn_rlimit {
+	__u32 resource;
+	__u32 __reserved;
+	__aligned_u64 rlim_cur;
+	__aligned_u64 rlim_max;
+};
+
+#define SPAWN_ACTION_DUP2		1
+#define SPAWN_ACTION_CLOSE_RANGE	2
+#define SPAWN_ACTION_FCHDIR		3
+
+extern char **environ;
+
+static pid_t sys_spawn(struct __clone_args *cargs, struct __spawn_args *sargs)
+{
+	return syscall(__NR_spawn, cargs, sizeof(*cargs), sargs, sizeof(*sargs));
+}
+
+static pid_t spawn_signal(const char *path, char *const argv[], int sig)
+{
+	struct __clone_args cargs = { .exit_signal = sig };
+	struct __spawn_args sargs = {
+		.pathname	= ptr_to_u64(path),
+		.argv		= ptr_to_u64(argv),
+		.envp		= ptr_to_u64(environ),
+		.dirfd		= AT_FDCWD,
+	};
+
+	return sys_spawn(&cargs, &sargs);
+}
+
+static pid_t spawn_simple(const char *path, char *const argv[])
+{
+	return spawn_signal(path, argv, SIGCHLD);
+}
+
+static int wait_exit(pid_t pid)
+{
+	int status;
+
+	if (waitpid(pid, &status, 0) != pid)
+		return -1;
+	if (!WIFEXITED(status))
+		return -1;
+	return WEXITSTATUS(status);
+}
+
+static int test_true(void)
+{
+	char *argv[] = { "true", NULL };
+	pid_t pid;
+
+	pid = spawn_simple("/bin/true", argv);
+	if (pid < 0) {
+		if (errno == ENOSYS)
+			ksft_exit_skip("spawn() not supported\n");
+		ksft_print_msg("spawn: %s\n", strerror(errno));
+		return -1;
+	}
+	return wait_exit(pid);
+}
+
+/*
+ * Route the child's stdout into a pipe, close everything above it, move
+ * to /tmp and lower RLIMIT_NOFILE, then have a shell report what it sees.
+ */
+static int test_actions(void)
+{
+	char *argv[] = { "sh", "-c",
+		"echo \"$(pwd) $(ulimit -n)\"; test -e /proc/self/fd/9 && echo leaked",
+		NULL };
+	struct __spawn_action actions[3];
+	struct __spawn_rlimit rlim = {
+		.resource	= RLIMIT_NOFILE,
+		.rlim_cur	= 64,
+		.rlim_max	= 64,
+	};
+	struct __clone_args cargs = {
+		.flags		= CLONE_PIDFD,
+		.exit_signal	= SIGCHLD,
+	};
+	struct __spawn_args sargs = {
+		.pathname	= ptr_to_u64("/bin/sh"),
+		.argv		= ptr_to_u64(argv),
+		.envp		= ptr_to_u64(environ),
+		.actions	= ptr_to_u64(actions),
+		.rlimits	= ptr_to_u64(&rlim),
+		.nr_actions	= 3,
+		.nr_rlimits	= 1,
+		.dirfd		= AT_FDCWD,
+	};
+	int pipefd[2], tmpfd, extra, pidfd = -1, ret = -1;
+	char buf[256] = "";
+	ssize_t len;
+	pid_t pid;
+
+	if (pipe(pipefd))
+		ksft_exit_fail_msg("pipe: %s\n", strerror(errno));
+	tmpfd = open("/tmp", O_RDONLY | O_DIRECTORY);
+	if (tmpfd < 0)
+		ksft_exit_fail_msg("open /tmp: %s\n", strerror(errno));
+	/* Left open without O_CLOEXEC, close_range must get rid of it */
+	extra = dup2(tmpfd, 9);
+	if (extra != 9)
+		ksft_exit_fail_msg("dup2: %s\n", strerror(errno));
+
+	actions[0] = (struct __spawn_action){
+		.type = SPAWN_ACTION_DUP2, .fd = pipefd[1], .newfd = 1,
+	};
+	actions[1] = (struct __spawn_action){
+		.type = SPAWN_ACTION_FCHDIR, .fd = tmpfd,
+	};
+	actions[2] = (struct __spawn_action){
+		.type = SPAWN_ACTION_CLOSE_RANGE, .fd = 3, .newfd = ~0U,
+	};
+	cargs.pidfd = ptr_to_u64(&pidfd);
+
+	pid = sys_spawn(&cargs, &sargs);
+	close(pipefd[1]);
+	if (pid < 0) {
+		ksft_print_msg("spawn: %s\n", strerror(errno));
+		goto out;
+	}
+	if (pidfd < 0)
+		ksft_print_msg("no pidfd returned\n");
+
+	len = read(pipefd[0], buf, sizeof(buf) - 1);
+	if (wait_exit(pid) || len <= 0)
+		goto out;
+	buf[len] = '\0';
+	if (strcmp(buf, "/tmp 64\n")) {
+		ksft_print_msg("child printed \"%s\"\n", buf);
+		goto out;
+	}
+	if (pidfd >= 0)
+		ret = 0;
+out:
+	if (pidfd >= 0)
+		close(pidfd);
+	close(pipefd[0]);
+	close(tmpfd);
+	close(extra);
+	return ret;
+}
+
+/*
+ * A failed exec is returned to us and the child is already reaped, also
+ * when it would not have sent us SIGCHLD.  Its exit signal is not sent.
+ */
+static int test_enoent(int sig)
+{
+	char *argv[] = { "missing", NULL };
+	struct timespec zero = { 0 };
+	sigset_t set, pending;
+	int ret = -1;
+	pid_t pid;
+
+	/* Block SIGCHLD and throw away any left by earlier tests */
+	sigemptyset(&set);
+	sigaddset(&set, SIGCHLD);
+	sigprocmask(SIG_BLOCK, &set, NULL);
+	while (sigtimedwait(&set, NULL, &zero) == SIGCHLD)
+		;
+
+	pid = spawn_signal("/nonexistent/spawn_test", argv, sig);
+	if (pid >= 0 || errno != ENOENT) {
+		ksft_print_msg("spawn returned %d: %s\n", pid, strerror(errno));
+		goto out;
+	}
+	if (waitpid(-1, NULL, WNOHANG | __WALL) != -1 || errno != ECHILD) {
+		ksft_print_msg("failed spawn left a child\n");
+		goto out;
+	}
+	sigpending(&pending);
+	if (sigismember(&pending, SIGCHLD)) {
+		ksft_print_msg("failed spawn sent SIGCHLD\n");
+		goto out;
+	}
+	ret = 0;
+out:
+	sigprocmask(SIG_UNBLOCK, &set, NULL);
+	return ret;
+}
+
+static int test_bad_action(void)
+{
+	struct __spawn_action action = { .type = 42 };
+	struct __clone_args cargs = { .exit_signal = SIGCHLD };
+	struct __spawn_args sargs = {
+		.pathname	= ptr_to_u64("/bin/true"),
+		.actions	= ptr_to_u64(&action),
+		.nr_actions	= 1,
+		.dirfd		= AT_FDCWD,
+	};
+
+	if (sys_spawn(&cargs, &sargs) >= 0 || errno != EINVAL)
+		return -1;
+
+	/* The child gets no stack of its own to run on */
+	cargs.stack = ptr_to_u64(&action);
+	cargs.stack_size = sizeof(action);
+	action.type = SPAWN_ACTION_DUP2;
+	if (sys_spawn(&cargs, &sargs) >= 0 || errno != EINVAL)
+		return -1;
+	return 0;
+}
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void bench(int iterations)
+{
+	char *argv[] = { "true", NULL };
+	double start, t_spawn, t_posix;
+	pid_t pid;
+	int i;
+
+	start = now();
+	for (i = 0; i < iterations; i++) {
+		pid = spawn_simple("/bin/true", argv);
+		if (pid < 0 || wait_exit(pid))
+			ksft_exit_fail_msg("spawn: %s\n", strerror(errno));
+	}
+	t_spawn = now() - start;
+
+	start = now();
+	for (i = 0; i < iterations; i++) {
+		errno = posix_spawn(&pid, "/bin/true", NULL, NULL, argv,
+				    environ);
+		if (errno || wait_exit(pid))
+			ksft_exit_fail_msg("posix_spawn: %s\n", strerror(errno));
+	}
+	t_posix = now() - start;
+
+	ksft_print_msg("%d runs of /bin/true: spawn() %.1f us, posix_spawn() %.1f us each\n",
+		       iterations, t_spawn * 1e6 / iterations,
+		       t_posix * 1e6 / iterations);
+}
+
+int main(int argc, char **argv)
+{
+	int iterations = 2000;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "n:")) != -1) {
+		switch (opt) {
+		case 'n':
+			iterations = atoi(optarg);
+			break;
+		default:
+			ksft_exit_fail_msg("usage: %s [-n iterations]\n",
+					   argv[0]);
+		}
+	}
+
+	ksft_print_header();
+	ksft_set_plan(5);
+
+	ksft_test_result(!test_true(), "spawn runs /bin/true\n");
+	ksft_test_result(!test_actions(), "file actions, cwd and rlimits\n");
+	ksft_test_result(!test_enoent(SIGCHLD), "failed exec is reported\n");
+	ksft_test_result(!test_enoent(0),
+			 "failed exec with no exit signal is reaped\n");
+	ksft_test_result(!test_bad_action(), "invalid arguments rejected\n");
+
+	if (iterations > 0)
+		bench(iterations);
+
+	if (ksft_get_fail_cnt())
+		ksft_exit_fail();
+	ksft_exit_pass();
+}
@@ -0,0 +1,245 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Check that statx_batch() returns the same results as statx() on every
+ * name, and compare the time both take to stat a whole tree.
+ *
+ *	statx_batch_test [-d dirs] [-f files-per-dir]
+ *
+ * The defaults build a small tree; -d 1000 -f 1000 gives 1M files.
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <ftw.h>
+#include <limits.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../kselftest.h"
+
+#ifndef __NR_statx_batch
+#define __NR_statx_batch 443
+#endif
+
+struct statx_batch_entry {
+	__u64	pathname;
+	__u64	buffer;
+	__s32	result;
+	__u32	__spare;
+};
+
+static int sys_statx_batch(int dfd, struct statx_batch_entry *entries,
+			   unsigned int nr, unsigned int flags,
+			   unsigned int mask)
+{
+	return syscall(__NR_statx_batch, dfd, entries, nr, flags, mask);
+}
+
+static int nr_dirs = 10, nr_files = 100;
+static char **names;
+static unsigned int nr_names;
+
+static void add_name(const char *fmt, ...)
+{
+	va_list ap;
+	char *name;
+
+	va_start(ap, fmt);
+	if (vasprintf(&name, fmt, ap) < 0)
+		ksft_exit_fail_msg("vasprintf: %s\n", strerror(errno));
+	va_end(ap);
+	names[nr_names++] = name;
+}
+
+static void build_tree(int dfd)
+{
+	char path[PATH_MAX];
+	int d, f, fd;
+
+	names = calloc((size_t)nr_dirs * nr_files + 16, sizeof(*names));
+	if (!names)
+		ksft_exit_fail_msg("calloc: %s\n", strerror(errno));
+
+	for (d = 0; d < nr_dirs; d++) {
+		snprintf(path, sizeof(path), "d%d", d);
+		if (mkdirat(dfd, path, 0755))
+			ksft_exit_fail_msg("mkdir %s: %s\n", path,
+					   strerror(errno));
+		for (f = 0; f < nr_files; f++) {
+			snprintf(path, sizeof(path), "d%d/f%d", d, f);
+			fd = openat(dfd, path, O_CREAT | O_WRONLY, 0644);
+			if (fd < 0)
+				ksft_exit_fail_msg("create %s: %s\n", path,
+						   strerror(errno));
+			close(fd);
+			add_name("d%d/f%d", d, f);
+		}
+	}
+
+	if (symlinkat("d0/f0", dfd, "d1/link") ||
+	    symlinkat("/", dfd, "d1/abslink"))
+		ksft_exit_fail_msg("symlink: %s\n", strerror(errno));
+
+	/* Names that must not be resolved from the cached directory */
+	add_name("d1/link");
+	add_name("d1/abslink");
+	add_name("d1/..");
+	add_name("d1/.");
+	add_name("d1/");
+	add_name("d1/missing");
+	add_name("missing/f0");
+	add_name("missing/f1");
+	add_name("d0/f0/f0");
+	add_name("d0");
+	add_name("/");
+}
+
+static int compare(unsigned int flags)
+{
+	struct statx_batch_entry *entries;
+	struct statx *batch_stx, stx;
+	unsigned int i;
+	int dfd = AT_FDCWD, ret, err, failed = 0;
+
+	entries = calloc(nr_names, sizeof(*entries));
+	batch_stx = calloc(nr_names, sizeof(*batch_stx));
+	if (!entries || !batch_stx)
+		ksft_exit_fail_msg("calloc: %s\n", strerror(errno));
+
+	for (i = 0; i < nr_names; i++) {
+		entries[i].pathname = (uintptr_t)names[i];
+		entries[i].buffer = (uintptr_t)&batch_stx[i];
+	}
+
+	ret = sys_statx_batch(dfd, entries, nr_names, flags, STATX_BASIC_STATS);
+	if (ret < 0) {
+		if (errno == ENOSYS)
+			ksft_exit_skip("statx_batch() not supported\n");
+		ksft_exit_fail_msg("statx_batch: %s\n", strerror(errno));
+	}
+	if ((unsigned int)ret != nr_names)
+		ksft_exit_fail_msg("statx_batch: %d of %u entries\n", ret,
+				   nr_names);
+
+	for (i = 0; i < nr_names; i++) {
+		err = statx(dfd, names[i], flags, STATX_BASIC_STATS, &stx) ?
+			-errno : 0;
+		if (err != entries[i].result) {
+			ksft_print_msg("%s: result %d, statx() %d\n", names[i],
+				       entries[i].result, err);
+			failed = 1;
+			continue;
+		}
+		if (err)
+			continue;
+		if (stx.stx_ino != batch_stx[i].stx_ino ||
+		    stx.stx_mode != batch_stx[i].stx_mode ||
+		    stx.stx_dev_major != batch_stx[i].stx_dev_major ||
+		    stx.stx_dev_minor != batch_stx[i].stx_dev_minor) {
+			ksft_print_msg("%s: differs from statx()\n", names[i]);
+			failed = 1;
+		}
+	}
+
+	free(batch_stx);
+	free(entries);
+	return failed;
+}
+
+static double elapsed(const struct timespec *start)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - start->tv_sec) +
+	       (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+static void benchmark(void)
+{
+	unsigned int nr = (unsigned int)nr_dirs * nr_files;
+	unsigned int chunk = 4096, i, n;
+	struct statx_batch_entry *entries;
+	struct timespec start;
+	struct statx stx;
+	double t_statx, t_batch;
+
+	entries = calloc(chunk, sizeof(*entries));
+	if (!entries)
+		ksft_exit_fail_msg("calloc: %s\n", strerror(errno));
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < nr; i++)
+		statx(AT_FDCWD, names[i], 0, STATX_BASIC_STATS, &stx);
+	t_statx = elapsed(&start);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < nr; i += n) {
+		unsigned int j;
+
+		n = nr - i < chunk ? nr - i : chunk;
+		for (j = 0; j < n; j++) {
+			entries[j].pathname = (uintptr_t)names[i + j];
+			entries[j].buffer = (uintptr_t)&stx;
+		}
+		sys_statx_batch(AT_FDCWD, entries, n, 0, STATX_BASIC_STATS);
+	}
+	t_batch = elapsed(&start);
+
+	ksft_print_msg("%u files: statx() %.3fs, statx_batch() %.3fs\n",
+		       nr, t_statx, t_batch);
+	free(entries);
+}
+
+static int remove_one(const char *path, const struct stat *st, int type,
+		      struct FTW *ftw)
+{
+	return remove(path);
+}
+
+int main(int argc, char **argv)
+{
+	char tmpl[] = "/tmp/statx_batch.XXXXXX";
+	int opt;
+
+	while ((opt = getopt(argc, argv, "d:f:")) != -1) {
+		switch (opt) {
+		case 'd':
+			nr_dirs = atoi(optarg);
+			break;
+		case 'f':
+			nr_files = atoi(optarg);
+			break;
+		default:
+			ksft_exit_fail_msg("usage: %s [-d dirs] [-f files]\n",
+					   argv[0]);
+		}
+	}
+	if (nr_dirs < 2 || nr_files < 1)
+		ksft_exit_fail_msg("need at least 2 dirs and 1 file\n");
+
+	ksft_print_header();
+	ksft_set_plan(2);
+
+	if (!mkdtemp(tmpl) || chdir(tmpl))
+		ksft_exit_fail_msg("%s: %s\n", tmpl, strerror(errno));
+	build_tree(AT_FDCWD);
+
+	ksft_test_result(!compare(0), "statx_batch matches statx\n");
+	ksft_test_result(!compare(AT_SYMLINK_NOFOLLOW),
+			 "statx_batch matches statx with AT_SYMLINK_NOFOLLOW\n");
+
+	benchmark();
+
+	if (chdir("/") || nftw(tmpl, remove_one, 64, FTW_DEPTH | FTW_PHYS))
+		ksft_print_msg("cannot remove %s: %s\n", tmpl, strerror(errno));
+	ksft_exit_pass();
+}
@@ -0,0 +1,186 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Measure how long fork() takes with a large populated anonymous mapping,
+ * and check that copy-on-write keeps the parent and the child apart in
+ * both directions afterwards.
+ *
+ * The mapping is run once with MADV_NOHUGEPAGE, where fork() copies one
+ * pte per page, and once with MADV_HUGEPAGE, where it copies one pmd per
+ * huge page.
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+#ifndef MADV_HUGEPAGE
+#define MADV_HUGEPAGE	14
+#endif
+#ifndef MADV_NOHUGEPAGE
+#define MADV_NOHUGEPAGE	15
+#endif
+
+#define DEFAULT_SIZE_MB	512
+
+#define BUG_ON(condition, description)					\
+	do {								\
+		if (condition) {					\
+			fprintf(stderr, "[FAIL]\t%s:%d\t%s:%s\n", __func__, \
+				__LINE__, (description), strerror(errno)); \
+			exit(1);					\
+		}							\
+	} while (0)
+
+static size_t pagesize;
+
+/* Every page starts with a word telling who wrote it last */
+#define ORIG_TAG	0x0a11ULL
+#define PARENT_TAG	0x9a4eULL
+#define CHILD_TAG	0xc41dULL
+
+static unsigned long long *word(char *map, size_t page)
+{
+	return (unsigned long long *)(map + page * pagesize);
+}
+
+static unsigned long long tag(unsigned long long who, size_t page)
+{
+	return who << 48 | page;
+}
+
+static void sync_write(int fd)
+{
+	char c = 0;
+
+	BUG_ON(write(fd, &c, 1) != 1, "write(pipe)");
+}
+
+static void sync_read(int fd)
+{
+	char c;
+
+	BUG_ON(read(fd, &c, 1) != 1, "read(pipe)");
+}
+
+/*
+ * The parent writes the even pages and the child the odd ones.  Each must
+ * see its own writes, and the original contents everywhere else.
+ */
+static int check(char *map, size_t nr_pages, unsigned long long self)
+{
+	size_t page;
+
+	for (page = 0; page < nr_pages; page++) {
+		unsigned long long expect = ORIG_TAG;
+
+		if (self == PARENT_TAG && !(page & 1))
+			expect = PARENT_TAG;
+		if (self == CHILD_TAG && (page & 1))
+			expect = CHILD_TAG;
+		if (*word(map, page) != tag(expect, page)) {
+			fprintf(stderr, "[FAIL]\t%s: page %zu is %llx, expected %llx\n",
+				self == PARENT_TAG ? "parent" : "child", page,
+				*word(map, page), tag(expect, page));
+			return 1;
+		}
+	}
+	return 0;
+}
+
+static int run(size_t size, int advice, const char *name)
+{
+	size_t nr_pages = size / pagesize, page;
+	int to_child[2], to_parent[2];
+	struct timespec start, end;
+	int status, ret;
+	pid_t child;
+	char *map;
+
+	map = mmap(NULL, size, PROT_READ | PROT_WRITE,
+		   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	BUG_ON(map == MAP_FAILED, "mmap()");
+
+	/* Huge pages may not be configured, the copy is still checked */
+	madvise(map, size, advice);
+
+	for (page = 0; page < nr_pages; page++)
+		*word(map, page) = tag(ORIG_TAG, page);
+
+	BUG_ON(pipe(to_child) || pipe(to_parent), "pipe()");
+
+	/* Don't let the child flush our buffered output a second time */
+	fflush(stdout);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	child = fork();
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	BUG_ON(child < 0, "fork()");
+
+	if (!child) {
+		/* Wait for the parent's writes, then make our own */
+		sync_read(to_child[0]);
+		for (page = 1; page < nr_pages; page += 2)
+			*word(map, page) = tag(CHILD_TAG, page);
+		ret = check(map, nr_pages, CHILD_TAG);
+		sync_write(to_parent[1]);
+		exit(ret);
+	}
+
+	printf("%-12s %zu MB: fork() took %.3f ms\n", name, size >> 20,
+	       (end.tv_sec - start.tv_sec) * 1e3 +
+	       (end.tv_nsec - start.tv_nsec) / 1e6);
+
+	for (page = 0; page < nr_pages; page += 2)
+		*word(map, page) = tag(PARENT_TAG, page);
+	sync_write(to_child[1]);
+	sync_read(to_parent[0]);
+
+	ret = check(map, nr_pages, PARENT_TAG);
+
+	BUG_ON(waitpid(child, &status, 0) != child, "waitpid()");
+	if (!WIFEXITED(status) || WEXITSTATUS(status))
+		ret = 1;
+
+	close(to_child[0]);
+	close(to_child[1]);
+	close(to_parent[0]);
+	close(to_parent[1]);
+	munmap(map, size);
+
+	printf("[%s]\t%s\n", ret ? "FAIL" : "PASS", name);
+	return ret;
+}
+
+int main(int argc, char **argv)
+{
+	size_t size_mb = DEFAULT_SIZE_MB;
+	int opt, ret = 0;
+
+	while ((opt = getopt(argc, argv, "s:")) != -1) {
+		switch (opt) {
+		case 's':
+			size_mb = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			fprintf(stderr, "Usage: %s [-s size in MB]\n", argv[0]);
+			return 1;
+		}
+	}
+	if (!size_mb) {
+		fprintf(stderr, "Size must be at least 1 MB\n");
+		return 1;
+	}
+
+	pagesize = getpagesize();
+
+	ret |= run(size_mb << 20, MADV_NOHUGEPAGE, "small pages");
+	ret |= run(size_mb << 20, MADV_HUGEPAGE, "huge pages");
+
+	return ret;
+}
@@ -231,6 +231,17 @@ else
 	echo "[PASS]"
 fi
 
+echo "----------------"
+echo "running fork_cow"
+echo "----------------"
+./fork_cow
+if [ $? -ne 0 ]; then
+	echo "[FAIL]"
+	exitcode=1
+else
+	echo "[PASS]"
+fi
+
 echo "-------------------------"
 echo "running mlock-random-test"
 echo "-------------------------"